@@ -0,0 +1,172 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "aot.h"
+#include "isa.h"
+#include "parser.h"
+
+// The mini registers the x86-64 registers hold; the others live in the
+// frame. eax, edx and r11d are scratch, rdi holds vars. The first five
+// are caller-saved, the rest are saved by the function if it uses them.
+#define NHARD 11
+#define NSCRATCH 5
+static const char *hard[NHARD] = {
+    "%ecx", "%esi", "%r8d", "%r9d", "%r10d", "%ebx", "%ebp", "%r12d", "%r13d", "%r14d", "%r15d"
+};
+static const char *saved[NHARD] = {
+    NULL, NULL, NULL, NULL, NULL, "%rbx", "%rbp", "%r12", "%r13", "%r14", "%r15"
+};
+
+static const char *aluName[OPCOUNT] = {
+    "movl", "addl", "subl", NULL, NULL, "andl", "orl", "xorl", "incl", "decl",
+    "movdqu", "movdqu", "paddd", "psubd", "pmulld", "pand", "por", "pxor", NULL
+};
+
+const char *aotSymbol = NULL;
+
+static FILE *code;      // what the compiler printed
+static FILE *out;       // the real stdout
+
+// A line of the output: an instruction, or the prefix form of a statement
+typedef struct {
+    int isInstr;
+    Instr ins;
+    char *text;
+} Line;
+
+static void operand(const Operand *opnd, char *buf) {
+    switch (opnd->kind) {
+    case OPND_REG:
+        if (opnd->val < NHARD) strcpy(buf, hard[opnd->val]);
+        else sprintf(buf, "%d(%%rsp)", 4 * (opnd->val - NHARD));
+        break;
+    case OPND_MEM: sprintf(buf, "%d(%%rdi)", opnd->val); break;
+    case OPND_IMM: sprintf(buf, "$%d", opnd->val); break;
+    case OPND_VREG: sprintf(buf, "%%xmm%d", opnd->val); break;
+    default: buf[0] = '\0'; break;
+    }
+}
+
+// In memory: a variable or a register kept in the frame
+static int inMemory(const Operand *opnd) {
+    return opnd->kind == OPND_MEM || (opnd->kind == OPND_REG && opnd->val >= NHARD);
+}
+
+static void translate(const Instr *ins, int n) {
+    char d[32], s[32];
+    const char *r;
+
+    operand(&ins->dst, d);
+    operand(&ins->src, s);
+    switch (ins->op) {
+    case OP_EXIT:
+        fprintf(out, "    movl %s, %%eax\n    jmp .L%s_return\n", d, aotSymbol);
+        break;
+    case OP_INC:
+    case OP_DEC:
+    case OP_VLOAD:
+    case OP_VSTORE:
+    case OP_VADD:
+    case OP_VSUB:
+    case OP_VMUL:
+    case OP_VAND:
+    case OP_VOR:
+    case OP_VXOR:
+        fprintf(out, "    %s %s%s%s\n", aluName[ins->op], s, s[0] ? ", " : "", d);
+        break;
+    case OP_MUL:
+        // imul writes a register
+        r = inMemory(&ins->dst) ? "%eax" : d;
+        if (r != d) fprintf(out, "    movl %s, %%eax\n", d);
+        if (ins->src.kind == OPND_IMM) fprintf(out, "    imull %s, %s, %s\n", s, r, r);
+        else fprintf(out, "    imull %s, %s\n", s, r);
+        if (r != d) fprintf(out, "    movl %%eax, %s\n", d);
+        break;
+    case OP_DIV:
+        // a zero divisor faults like on sim; x / -1 wraps instead of
+        // trapping on INT_MIN
+        fprintf(out, "    movl %s, %%r11d\n    testl %%r11d, %%r11d\n    je .L%s_fault\n", s, aotSymbol);
+        fprintf(out, "    movl %s, %%eax\n    cmpl $-1, %%r11d\n    jne .L%s_div%d\n", d, aotSymbol, n);
+        fprintf(out, "    negl %%eax\n    jmp .L%s_quot%d\n", aotSymbol, n);
+        fprintf(out, ".L%s_div%d:\n    cltd\n    idivl %%r11d\n", aotSymbol, n);
+        fprintf(out, ".L%s_quot%d:\n    movl %%eax, %s\n", aotSymbol, n, d);
+        break;
+    default:
+        // one memory operand per instruction
+        if (inMemory(&ins->dst) && inMemory(&ins->src)) {
+            fprintf(out, "    movl %s, %%eax\n", s);
+            strcpy(s, "%eax");
+        }
+        fprintf(out, "    %s %s, %s\n", aluName[ins->op], s, d);
+        break;
+    }
+}
+
+static void finishAot(void) {
+    Line *line = NULL;
+    char *buf = NULL;
+    size_t bufCap = 0;
+    ssize_t len;
+    int n = 0, cap = 0, i, regs = 0, frame, ninstr = 0;
+
+    fflush(stdout);
+    fseek(code, 0, SEEK_SET);
+    while ((len = getline(&buf, &bufCap, code)) > 0) {
+        while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\r' || buf[len - 1] == ' ')) buf[--len] = '\0';
+        if (len == 0) continue;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 256;
+            line = (Line*)realloc(line, sizeof(Line) * cap);
+        }
+        line[n].isInstr = parseInstr(buf, &line[n].ins);
+        line[n].text = line[n].isInstr ? NULL : strdup(buf);
+        if (line[n].isInstr) {
+            ninstr++;
+            if (line[n].ins.dst.kind == OPND_REG && line[n].ins.dst.val >= regs) regs = line[n].ins.dst.val + 1;
+            if (line[n].ins.src.kind == OPND_REG && line[n].ins.src.val >= regs) regs = line[n].ins.src.val + 1;
+        }
+        n++;
+    }
+    free(buf);
+    // nothing was compiled, the compiler stopped on an error of its own
+    if (ninstr == 0) return;
+
+    fprintf(out, "# int %s(int32_t *vars), generated by the mini compiler\n#\n", aotSymbol);
+    for (i = 0; i < sbcount; i++)
+        fprintf(out, "#     vars[%d]\t%s\n", varAddress(i) / 4, table[i].name);
+    fprintf(out, "\n    .text\n    .globl %s\n    .type %s, @function\n%s:\n", aotSymbol, aotSymbol, aotSymbol);
+    for (i = NSCRATCH; i < regs && i < NHARD; i++) fprintf(out, "    pushq %s\n", saved[i]);
+    // the registers past the hard ones, 16-byte aligned
+    frame = regs > NHARD ? ((regs - NHARD) * 4 + 15) / 16 * 16 : 0;
+    if (frame > 0) fprintf(out, "    subq $%d, %%rsp\n", frame);
+
+    for (i = 0; i < n; i++) {
+        if (line[i].isInstr) translate(&line[i].ins, i);
+        else fprintf(out, "# %s\n", line[i].text);
+        free(line[i].text);
+    }
+    free(line);
+
+    fprintf(out, ".L%s_fault:\n    movl $-1, %%eax\n.L%s_return:\n", aotSymbol, aotSymbol);
+    if (frame > 0) fprintf(out, "    addq $%d, %%rsp\n", frame);
+    for (i = (regs < NHARD ? regs : NHARD) - 1; i >= NSCRATCH; i--) fprintf(out, "    popq %s\n", saved[i]);
+    fprintf(out, "    ret\n    .size %s, .-%s\n", aotSymbol, aotSymbol);
+    fprintf(out, "    .section .note.GNU-stack,\"\",@progbits\n");
+    fflush(out);
+}
+
+int openAot(const char *symbol) {
+    int fd;
+
+    aotSymbol = symbol;
+    fflush(stdout);
+    if ((code = tmpfile()) == NULL || (fd = dup(STDOUT_FILENO)) < 0 || (out = fdopen(fd, "w")) == NULL ||
+        dup2(fileno(code), STDOUT_FILENO) < 0) {
+        perror("-faot");
+        return 0;
+    }
+    atexit(finishAot);
+    return 1;
+}
@@ -0,0 +1,13 @@
+#ifndef __AOT__
+#define __AOT__
+
+// Enabled with -faot[=SYMBOL]: the code of the program goes out as x86-64
+// GNU assembler, one function int SYMBOL(int32_t *vars) following the
+// System V ABI. Variable i is vars[i], the word at 4*i; the function
+// returns the EXIT code, or -1 where the code divides by zero
+extern const char *aotSymbol;
+
+// Capture stdout from here on; it is translated at exit. Return 0 on error
+extern int openAot(const char *symbol);
+
+#endif // __AOT__
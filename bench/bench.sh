@@ -0,0 +1,64 @@
+#!/bin/sh
+# Code-quality benchmark
+# Compiles every program in bench/corpus, runs the output on the simulator
+# and records simulated cycles per statement in bench/history.tsv.
+# A program whose cycles per statement grew by more than the threshold
+# since the last recorded run with the same flags is a regression.
+#
+# Usage: bench/bench.sh [-c latency.cfg] [-t percent] [-n] [-- compiler flags]
+#   -c  latency table passed to the simulator
+#   -t  allowed growth of cycles per statement, default 0
+#   -n  do not append the results to the history
+
+set -e
+root=$(cd "$(dirname "$0")/.." && pwd)
+history="$root/bench/history.tsv"
+simcfg=""
+threshold=0
+record=1
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+    -c) simcfg="-c $2"; shift 2 ;;
+    -t) threshold="$2"; shift 2 ;;
+    -n) record=0; shift ;;
+    --) shift; break ;;
+    *) echo "usage: $0 [-c latency.cfg] [-t percent] [-n] [-- compiler flags]" >&2; exit 2 ;;
+    esac
+done
+flags="$*"
+
+build=$(mktemp -d)
+trap 'rm -rf "$build"' EXIT
+cd "$root"
+${CC:-gcc} -O2 -pthread -o "$build/compiler" main.c lex.c parser.c codeGen.c opt.c parallel.c cache.c promote.c trace.c stream.c push.c isel.c passes.c isa.c linecost.c sim.c slp.c sched.c incr.c rules.c layout.c latency.c rewrite.c rewriteMatch.c aot.c snapshot.c memstat.c memo.c
+${CC:-gcc} -O2 -o "$build/sim" simmain.c sim.c isa.c
+
+version=$(git describe --always --dirty 2>/dev/null || echo unknown)
+[ -f "$history" ] || printf 'version\tflags\tprogram\tstatements\tinstructions\tcycles\tcycles_per_stmt\n' > "$history"
+
+status=0
+printf '%-20s %6s %8s %8s %10s %8s\n' program stmts instrs cycles cyc/stmt change
+for prog in bench/corpus/*.txt; do
+    name=$(basename "$prog" .txt)
+    stmts=$(grep -c '[^[:space:]]' "$prog" || true)
+    # shellcheck disable=SC2086
+    report=$("$build/compiler" $flags < "$prog" | "$build/sim" $simcfg) || {
+        echo "$name: simulation failed" >&2
+        echo "$report" | grep '^fault' >&2
+        status=1
+        continue
+    }
+    instrs=$(echo "$report" | awk '$1 == "instructions" { print $2 }')
+    cycles=$(echo "$report" | awk '$1 == "cycles" { print $2 }')
+    per=$(awk -v c="$cycles" -v s="$stmts" 'BEGIN { printf "%.2f", c / s }')
+    last=$(awk -F '\t' -v f="$flags" -v p="$name" '$2 == f && $3 == p { v = $7 } END { print v }' "$history")
+    change=$(awk -v old="$last" -v new="$per" 'BEGIN { if (old == "") print "new"; else printf "%+.1f%%", (new - old) * 100 / old }')
+    printf '%-20s %6d %8d %8d %10s %8s\n' "$name" "$stmts" "$instrs" "$cycles" "$per" "$change"
+    if [ -n "$last" ] && awk -v old="$last" -v new="$per" -v t="$threshold" 'BEGIN { exit !(new > old * (1 + t / 100)) }'; then
+        echo "$name: regression, $last -> $per cycles per statement" >&2
+        status=1
+    fi
+    [ $record -eq 1 ] && printf '%s\t%s\t%s\t%d\t%d\t%d\t%s\n' "$version" "$flags" "$name" "$stmts" "$instrs" "$cycles" "$per" >> "$history"
+done
+exit $status
@@ -0,0 +1,324 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cache.h"
+#include "codeGen.h"
+#include "opt.h"
+#include "trace.h"
+#include "isel.h"
+#include "passes.h"
+#include "rules.h"
+
+#define SLOTSIZE 1024
+#define WAYS 8          // slots per set, LRU within a set
+#define MAXIDENT 32     // distinct variables of a cached statement
+
+typedef struct {
+    char magic[8];
+    char stamp[32];
+    uint64_t nsets;
+    uint64_t tick;      // bumped on every use, orders the slots for LRU
+} CacheHeader;
+
+// Symbol table change made by a statement, one per variable it names
+typedef struct {
+    int32_t val;
+    int16_t order;      // position among the variables it defines, or -1
+    int16_t known;
+} Effect;
+
+typedef struct {
+    uint64_t key[2];    // hash of the key, 0 0 if the slot is empty
+    uint64_t used;      // tick of the last use
+    uint32_t len;       // bytes of code after the effects
+    uint16_t nident;
+    uint16_t ndefined;
+    char data[SLOTSIZE - 32];
+} CacheSlot;
+
+// A variable named by the statement being compiled
+typedef struct {
+    const char *name;
+    int len;
+} Ident;
+
+static CacheHeader *header = NULL;
+static CacheSlot *slots = NULL;
+static long long hits = 0, misses = 0, evictions = 0, uncached = 0;
+
+static void printCacheStats(void) {
+    fprintf(stderr, "cache: %lld hits, %lld misses, %lld evictions, %lld lines not cacheable\n",
+        hits, misses, evictions, uncached);
+}
+
+void openCache(const char *path, int mbytes) {
+    struct stat st;
+    uint64_t nsets = ((uint64_t)mbytes << 20) / (SLOTSIZE * WAYS);
+    size_t size;
+    char *base;
+    int fd;
+
+    if (nsets == 0) nsets = 1;
+    size = SLOTSIZE + nsets * WAYS * SLOTSIZE;
+    if ((fd = open(path, O_RDWR | O_CREAT, 0644)) < 0 || flock(fd, LOCK_EX) < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        exit(2);
+    }
+    if ((size_t)st.st_size != size && (ftruncate(fd, 0) < 0 || ftruncate(fd, size) < 0)) {
+        perror(path);
+        exit(2);
+    }
+    base = (char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == (char*)MAP_FAILED) {
+        perror(path);
+        exit(2);
+    }
+    header = (CacheHeader*)base;
+    slots = (CacheSlot*)(base + SLOTSIZE);
+    if (memcmp(header->magic, "MCCACHE1", 8) != 0 || memcmp(header->stamp, buildStamp(), sizeof(header->stamp)) != 0 ||
+        header->nsets != nsets) {
+        memset(base, 0, size);
+        memcpy(header->magic, "MCCACHE1", 8);
+        memcpy(header->stamp, buildStamp(), sizeof(header->stamp));
+        header->nsets = nsets;
+    }
+    atexit(printCacheStats);
+}
+
+static uint64_t splitmix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static void hashWord(uint64_t key[2], uint64_t w) {
+    key[0] = splitmix(key[0] ^ w);
+    key[1] = splitmix(key[1] + w * 0xff51afd7ed558ccdull);
+}
+
+static void hashBytes(uint64_t key[2], const char *s, size_t n) {
+    uint64_t w;
+    for (; n >= 8; s += 8, n -= 8) {
+        memcpy(&w, s, 8);
+        hashWord(key, w);
+    }
+    w = 0;
+    memcpy(&w, s, n);
+    hashWord(key, w ^ (uint64_t)n << 56);
+}
+
+// Collapse blanks into single spaces; return the length, or -1 if the
+// line is unterminated or has unusual characters
+static int normalize(const char *line, size_t n, char *out) {
+    int len = 0;
+    size_t i;
+
+    if (n == 0 || line[n - 1] != '\n') return -1;
+    for (i = 0; i + 1 < n; i++) {
+        if (line[i] == ' ' || line[i] == '\t') {
+            if (len > 0 && out[len - 1] != ' ') out[len++] = ' ';
+        }
+        else if (line[i] > ' ' && line[i] < 127) out[len++] = line[i];
+        else return -1;
+    }
+    if (len > 0 && out[len - 1] == ' ') len--;
+    out[len] = '\0';
+    return len;
+}
+
+// Find the distinct variables of a normalized statement, scanning like the lexer
+static int findIdents(const char *s, Ident *ids) {
+    int n = 0, i, len;
+
+    while (*s) {
+        if (isdigit((unsigned char)*s)) {
+            for (len = 0; isdigit((unsigned char)s[len]); len++);
+        } else if (isalpha((unsigned char)*s)) {
+            for (len = 0; isalnum((unsigned char)s[len]) || s[len] == '_'; len++);
+            for (i = 0; i < n; i++)
+                if (ids[i].len == len && strncmp(ids[i].name, s, len) == 0) break;
+            if (i == n) {
+                if (n == MAXIDENT) return -1;
+                ids[n].name = s;
+                ids[n++].len = len;
+            }
+        } else {
+            len = 1;
+        }
+        if (len >= MAXLEN - 1) return -1;
+        s += len;
+    }
+    return n;
+}
+
+static int lookupIdent(const Ident *id) {
+    char name[MAXLEN];
+    memcpy(name, id->name, id->len);
+    name[id->len] = '\0';
+    return getvariable(name);
+}
+
+// Key: normalized text, options, rules, target and its registers, and the address (and constant fact)
+// of every variable the statement names
+static void makeKey(const char *norm, int len, const Ident *ids, int nident, uint64_t key[2]) {
+    int i, idx, undefined = 0;
+
+    key[0] = 0x6d696e69636f6d70ull;
+    key[1] = 0x63616368656b6579ull;
+    hashBytes(key, norm, len);
+    hashWord(key, (uint64_t)(pipelineKey() << 1 | optIsel));
+    hashWord(key, rulesKey());
+    hashWord(key, (uint64_t)(backend - targets));
+    // sched renames registers within the registers of the target
+    hashWord(key, (uint64_t)targetRegs);
+    for (i = 0; i < nident; i++) {
+        idx = lookupIdent(&ids[i]);
+        hashWord(key, (uint64_t)(int64_t)idx);
+        if (idx == -1) undefined = 1;
+        else if (optConstProp && table[idx].known) hashWord(key, 1ull << 32 | (uint32_t)table[idx].val);
+    }
+    // new variables get the next free addresses
+    if (undefined) hashWord(key, (uint64_t)sbcount);
+    if (key[0] == 0 && key[1] == 0) key[0] = 1;
+}
+
+static CacheSlot *findSlot(const uint64_t key[2]) {
+    CacheSlot *set = &slots[(key[0] % header->nsets) * WAYS];
+    int i;
+    for (i = 0; i < WAYS; i++)
+        if (set[i].key[0] == key[0] && set[i].key[1] == key[1]) return &set[i];
+    return NULL;
+}
+
+// Print the cached code and replay the symbol table changes
+static void replay(CacheSlot *slot, const Ident *ids) {
+    const Effect *eff = (const Effect*)slot->data;
+    char name[MAXLEN];
+    int i, k, idx;
+
+    fwrite(slot->data + slot->nident * sizeof(Effect), 1, slot->len, stdout);
+    for (k = 0; k < slot->ndefined; k++)
+        for (i = 0; i < slot->nident; i++)
+            if (eff[i].order == k) {
+                memcpy(name, ids[i].name, ids[i].len);
+                name[ids[i].len] = '\0';
+                setvariable(name);
+            }
+    for (i = 0; i < slot->nident; i++) {
+        idx = lookupIdent(&ids[i]);
+        table[idx].known = eff[i].known;
+        table[idx].val = eff[i].val;
+    }
+    slot->used = ++header->tick;
+}
+
+// Store the code of a compiled statement, evicting the least recently used slot
+static void insert(const uint64_t key[2], const Ident *ids, int nident, const int *before, const OutBuf *out) {
+    CacheSlot *set = &slots[(key[0] % header->nsets) * WAYS], *slot = &set[0];
+    Effect eff[MAXIDENT];
+    int i, idx, ndefined = 0, first = sbcount;
+
+    if (nident * sizeof(Effect) + out->len > sizeof(slot->data)) return;
+    for (i = 0; i < nident; i++) {
+        if ((idx = lookupIdent(&ids[i])) == -1) return;
+        eff[i].val = table[idx].val;
+        eff[i].known = (int16_t)table[idx].known;
+        eff[i].order = -1;
+        if (before[i] == -1) {
+            eff[i].order = (int16_t)idx;
+            ndefined++;
+            if (idx < first) first = idx;
+        }
+    }
+    for (i = 0; i < nident; i++)
+        if (eff[i].order != -1) eff[i].order -= (int16_t)first;
+
+    for (i = 0; i < WAYS; i++) {
+        if (set[i].key[0] == 0 && set[i].key[1] == 0) {
+            slot = &set[i];
+            break;
+        }
+        if (set[i].used < slot->used) slot = &set[i];
+    }
+    if (i == WAYS) evictions++;
+    memcpy(slot->data, eff, nident * sizeof(Effect));
+    memcpy(slot->data + nident * sizeof(Effect), out->data, out->len);
+    slot->key[0] = key[0];
+    slot->key[1] = key[1];
+    slot->len = (uint32_t)out->len;
+    slot->nident = (uint16_t)nident;
+    slot->ndefined = (uint16_t)ndefined;
+    slot->used = ++header->tick;
+}
+
+// Compile a line whose code is not cached yet and remember it
+static void compileMiss(const char *line, size_t n, const uint64_t key[2], const Ident *ids, int nident) {
+    int before[MAXIDENT], i;
+    OutBuf out = { NULL, 0, 0 };
+    jmp_buf jb;
+
+    for (i = 0; i < nident; i++)
+        before[i] = lookupIdent(&ids[i]);
+    setOutput(&out);
+    errorJump = &jb;
+    if (setjmp(jb) != 0) {
+        // the error ends the program, nothing is cached
+        fwrite(out.data, 1, out.len, stdout);
+        exit(0);
+    }
+    compileLine(line, n);
+    errorJump = NULL;
+    setOutput(NULL);
+    fwrite(out.data, 1, out.len, stdout);
+    insert(key, ids, nident, before, &out);
+    freeOutput(&out);
+}
+
+void compileCached(void) {
+    char *line = NULL, *norm = NULL;
+    size_t cap = 0, normcap = 0;
+    ssize_t n;
+    Ident ids[MAXIDENT];
+    uint64_t key[2];
+    CacheSlot *slot;
+    int len, nident;
+    long long start;
+
+    while ((n = getline(&line, &cap, stdin)) > 0) {
+        if (normcap < cap) {
+            normcap = cap;
+            norm = (char*)realloc(norm, normcap);
+        }
+        if ((len = normalize(line, n, norm)) == 0) {
+            compileLine(line, n);
+            continue;
+        }
+        if (len < 0 || (nident = findIdents(norm, ids)) < 0) {
+            uncached++;
+            compileLine(line, n);
+            continue;
+        }
+        start = traceClock();
+        makeKey(norm, len, ids, nident, key);
+        if ((slot = findSlot(key)) != NULL) {
+            hits++;
+            replay(slot, ids);
+            traceSpan("cache hit", start, "bytes", slot->len);
+        } else {
+            misses++;
+            compileMiss(line, n, key, ids, nident);
+            traceSpan("cache miss", start, NULL, 0);
+        }
+    }
+    endProgram();
+    exit(0);
+}
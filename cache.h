@@ -0,0 +1,12 @@
+#ifndef __CACHE__
+#define __CACHE__
+
+// Open or create the compile cache file at path, at most mbytes megabytes
+extern void openCache(const char *path, int mbytes);
+
+// Compile stdin line by line. A statement whose normalized text and
+// referenced symbol state were compiled before prints its cached code
+// without being parsed. Exits like statement does at the end of input.
+extern void compileCached(void);
+
+#endif // __CACHE__
@@ -2,92 +2,182 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 #include "codeGen.h"
+#include "memstat.h"
 
-int nowregister = 0;
+int targetRegs = 8;
+_Thread_local int codeLine = 0;
+
+static _Thread_local int nowregister = 0, peakregister = 0;
+static _Thread_local OutBuf *output = NULL;
+
+void setOutput(OutBuf *buf) { output = buf; }
+OutBuf *getOutput(void) { return output; }
+
+static void vemit(OutBuf *buf, const char *fmt, va_list ap) {
+    va_list again;
+    int n;
+
+    va_copy(again, ap);
+    n = vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, ap);
+    if (buf->len + n >= buf->cap) {
+        size_t cap = (buf->cap + n + 1) * 2;
+        buf->data = (char*)memRealloc(MEM_CODE, buf->data, buf->cap, cap);
+        buf->cap = cap;
+        vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, again);
+    }
+    va_end(again);
+    buf->len += n;
+}
+
+void emit(const char *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    if (output == NULL) vprintf(fmt, ap);
+    else vemit(output, fmt, ap);
+    va_end(ap);
+}
+
+void freeOutput(OutBuf *buf) {
+    memFree(MEM_CODE, buf->data, buf->cap);
+    buf->data = NULL;
+    buf->len = buf->cap = 0;
+}
+
+void emitTo(OutBuf *buf, const char *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    vemit(buf, fmt, ap);
+    va_end(ap);
+}
 
 void resetRegister() { nowregister = 0; }
-int allocateRegister() { return nowregister++; }
+int allocateRegister() {
+    if (nowregister >= targetRegs) outOfRegisters();
+    if (nowregister >= peakregister) peakregister = nowregister + 1;
+    return nowregister++;
+}
+int peakRegisters(void) {
+    int peak = peakregister;
+    peakregister = nowregister;
+    return peak;
+}
 void freeRegister() { if (nowregister > 0) nowregister--; }
+int registersFull(void) { return nowregister >= targetRegs; }
 
-int evaluateTree(BTNode* root) {
-    int reg = -1, lreg, rreg, varidx;
-    switch (root->data) {
-    case ID:
-		varidx = getvariable(root->lexeme);
-        if (varidx != -1) {
-            reg = allocateRegister();
-            printf("MOV r%d [%d]\n", reg, 4*varidx);  // load variable
-        } else error(UNDEFVAR);
-        break;
-
-    case INT:
-        reg = allocateRegister();
-        printf("MOV r%d %s\n", reg, root->lexeme);    // load constant
-        break;
+void outOfRegisters(void) {
+    fprintf(stderr, "line %d: the statement needs more than %d registers\n", codeLine, targetRegs);
+    error(RUNOUT);
+}
 
-    case ASSIGN:
-		varidx = getvariable(root->left->lexeme);
-        if (varidx == -1) {
-            varidx = setvariable(root->left->lexeme);
-        }
-        rreg = evaluateTree(root->right);
-        printf("MOV [%d] r%d\n", 4*varidx, rreg); // store value
-        reg = rreg; // result kept in rreg
-        break;
-
-	case ADDSUB_ASSIGN:
-	case UNARY:
-		varidx = getvariable(root->left->lexeme);
-		if (varidx != -1) {
-		    rreg = evaluateTree(root->right);
-            lreg = allocateRegister();
-			printf("MOV r%d [%d]\n", lreg, 4 * varidx);  // load variable
-            printf("%s r%d r%d\n", root->lexeme[0] == '+' ? "ADD" : "SUB", lreg, rreg);
-		    printf("MOV [%d] r%d\n", 4 * varidx, lreg); // store value
-			printf("MOV r%d r%d\n", rreg, lreg); // copy value
-		    reg = rreg; // result kept in rreg
-            freeRegister();
-		} else error(UNDEFVAR);
-		break;
-
-    case OR:
-    case XOR:
-    case AND:
-    case ADDSUB:
-    case MULDIV:
-        lreg = evaluateTree(root->left);
-        rreg = evaluateTree(root->right);
-
-        if (strcmp(root->lexeme, "+") == 0)
-            printf("ADD r%d r%d\n", lreg, rreg);
-        else if (strcmp(root->lexeme, "-") == 0)
-            printf("SUB r%d r%d\n", lreg, rreg);
-        else if (strcmp(root->lexeme, "*") == 0)
-            printf("MUL r%d r%d\n", lreg, rreg);
-        else if (strcmp(root->lexeme, "/") == 0)
-            printf("DIV r%d r%d\n", lreg, rreg);
-        else if (strcmp(root->lexeme, "|") == 0)
-            printf("OR r%d r%d\n", lreg, rreg);
-        else if (strcmp(root->lexeme, "&") == 0)
-            printf("AND r%d r%d\n", lreg, rreg);
-        else if (strcmp(root->lexeme, "^") == 0)
-            printf("XOR r%d r%d\n", lreg, rreg);
-
-        freeRegister();   // free rreg
-        reg = lreg;       // result stays in lreg
-        break;
-
-    default: // handle error or noop
-        break;
+// Register of a variable node kept in a register, -1 otherwise
+static int heldRegister(Tree *t, int i) {
+    int varidx;
+    if (t->node[i].data != ID || (varidx = getvariable(nodeLexeme(t, i))) == -1) return -1;
+    return table[varidx].reg;
+}
+
+int loadLeaf(Tree *t, int i) {
+    int reg = -1, varidx;
+
+    if (t->node[i].data == INT) {
+        reg = allocateRegister();
+        emit("%s r%d %s\n", backend->mnemonic[OP_MOV], reg, nodeLexeme(t, i));    // load constant
+        return reg;
     }
+    varidx = getvariable(nodeLexeme(t, i));
+    if (varidx != -1) {
+        reg = allocateRegister();
+        if (table[varidx].reg >= 0)
+            emit("%s r%d r%d\n", backend->mnemonic[OP_MOV], reg, table[varidx].reg);  // copy promoted variable
+        else
+            emit("%s r%d [%d]\n", backend->mnemonic[OP_MOV], reg, varAddress(varidx));  // load variable
+    } else error(UNDEFVAR);
     return reg;
 }
 
-void printPrefix(BTNode *root) {
-    if (root != NULL) {
-        printf("%s ", root->lexeme);
-        printPrefix(root->left);
-        printPrefix(root->right);
+// Postfix order is evaluation order: a node finds the registers of its
+// children in reg. The target of an assignment is resolved when it is
+// passed, before the right side, like the variables it reads.
+int evaluateTree(Tree *t) {
+    int *reg = (int*)treeScratch(t, sizeof(int));
+    int i, lreg, rreg, varidx, held;
+    const char *op;
+
+    for (i = 0; i < t->n; i++) {
+        BTNode *node = &t->node[i];
+        reg[i] = -1;
+        switch (node->data) {
+        case ID:
+            if (node->flags & NODE_ASSIGNED) {
+                if (getvariable(nodeLexeme(t, i)) == -1) setvariable(nodeLexeme(t, i));
+            } else if (node->flags & NODE_UPDATED) {
+                if (getvariable(nodeLexeme(t, i)) == -1) error(UNDEFVAR);
+            } else if (!(node->flags & NODE_OPERAND) || heldRegister(t, i) < 0) {
+                // a promoted variable is read in place as the right operand
+                reg[i] = loadLeaf(t, i);
+            }
+            break;
+
+        case INT:
+            reg[i] = loadLeaf(t, i);
+            break;
+
+        case ASSIGN:
+            varidx = getvariable(nodeLexeme(t, node->left));
+            rreg = reg[node->right];
+            if (table[varidx].reg >= 0)
+                emit("%s r%d r%d\n", backend->mnemonic[OP_MOV], table[varidx].reg, rreg); // store deferred
+            else
+                emit("%s [%d] r%d\n", backend->mnemonic[OP_MOV], varAddress(varidx), rreg); // store value
+            reg[i] = rreg; // result kept in rreg
+            break;
+
+        case ADDSUB_ASSIGN:
+        case UNARY:
+            varidx = getvariable(nodeLexeme(t, node->left));
+            op = backend->mnemonic[node->op];
+            rreg = reg[node->right];
+            if (table[varidx].reg >= 0) {
+                emit("%s r%d r%d\n", op, table[varidx].reg, rreg);
+                emit("%s r%d r%d\n", backend->mnemonic[OP_MOV], rreg, table[varidx].reg); // copy value
+            } else {
+                lreg = allocateRegister();
+                emit("%s r%d [%d]\n", backend->mnemonic[OP_MOV], lreg, varAddress(varidx));  // load variable
+                emit("%s r%d r%d\n", op, lreg, rreg);
+                emit("%s [%d] r%d\n", backend->mnemonic[OP_MOV], varAddress(varidx), lreg); // store value
+                emit("%s r%d r%d\n", backend->mnemonic[OP_MOV], rreg, lreg); // copy value
+                freeRegister();
+            }
+            reg[i] = rreg; // result kept in rreg
+            break;
+
+        case OR:
+        case XOR:
+        case AND:
+        case ADDSUB:
+        case MULDIV:
+            lreg = reg[node->left];
+            held = heldRegister(t, node->right);
+            rreg = held >= 0 ? held : reg[node->right];
+            emit("%s r%d r%d\n", backend->mnemonic[node->op], lreg, rreg);
+            if (held < 0) freeRegister();   // free rreg
+            reg[i] = lreg;       // result stays in lreg
+            break;
+
+        default: // handle error or noop
+            break;
+        }
     }
+    return t->n > 0 ? reg[t->n - 1] : -1;
+}
+
+void printPrefix(Tree *t) {
+    int *order, n = t->n > 0 ? prefixOrder(t, t->n - 1, &order) : 0;
+
+    for (int i = 0; i < n; i++)
+        emit("%s ", nodeLexeme(t, order[i]));
 }
@@ -3,12 +3,57 @@
 
 #include "parser.h"
 
+// Growable buffer collecting the printed code
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} OutBuf;
+
+// Send the output of this thread to buf, or to stdout if buf is NULL
+extern void setOutput(OutBuf *buf);
+
+// The buffer the output of this thread goes to, NULL for stdout
+extern OutBuf *getOutput(void);
+
+// Print to the current output
+extern void emit(const char *fmt, ...);
+
+// Print to buf, whatever the current output is
+extern void emitTo(OutBuf *buf, const char *fmt, ...);
+
+// Free the memory of buf and empty it
+extern void freeOutput(OutBuf *buf);
+
+// Registers of the target, set with -fregs=N or by -ftarget
+extern int targetRegs;
+
+// Input line of the statement the code is generated for
+extern _Thread_local int codeLine;
+
+extern void resetRegister();
+// Next free register; stops the statement with RUNOUT when all the
+// registers of the target are in use
+extern int allocateRegister();
 extern void freeRegister();
 
-// Evaluate the syntax tree
-extern int evaluateTree(BTNode* root);
+// 1 if allocateRegister would run out of registers
+extern int registersFull(void);
+
+// Tell on stderr that the statement of codeLine needs more registers
+// than the target has, and fail it with RUNOUT
+extern void outOfRegisters(void);
+
+// Most registers in use at once since the last call
+extern int peakRegisters(void);
+
+// Load the variable or constant of leaf i into a new register
+extern int loadLeaf(Tree *t, int i);
+
+// Evaluate the syntax tree in one pass over its nodes
+extern int evaluateTree(Tree *t);
 
 // Print the syntax tree in prefix
-extern void printPrefix(BTNode *root);
+extern void printPrefix(Tree *t);
 
 #endif // __CODEGEN__
@@ -0,0 +1,469 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "incr.h"
+#include "codeGen.h"
+#include "isel.h"
+#include "passes.h"
+#include "trace.h"
+#include "rules.h"
+#include "memstat.h"
+
+#define MAXEDIT 1000    // edits the diff looks for before it gives up
+
+typedef struct {
+    char magic[8];
+    char stamp[32];
+    uint64_t options;
+    uint64_t nlines;
+    uint64_t nsym;
+    char names[TBLSIZE][MAXLEN];    // symbol table at the end
+} StateHeader;
+
+// Saved state of one input line, followed by its VarStates, its text
+// and its code
+typedef struct {
+    uint32_t textLen;
+    uint32_t codeLen;
+    int32_t sbBefore;   // symbols defined before the line
+    int32_t nvar;       // variables it names, in the order they appear
+} LineHeader;
+
+// A variable named by a line: its address and its fact after the line.
+// The edges of the dependency graph: a line reads the variables it
+// names and writes the ones it changed.
+typedef struct {
+    int32_t idx;
+    int32_t val;
+    int16_t known;
+    int16_t changed;    // defined or given another fact by the line
+} VarState;
+
+typedef struct {
+    const char *rec;    // record in the state file
+    size_t size;
+    LineHeader h;
+    const char *text;
+    const char *code;
+    uint64_t hash;
+} OldLine;
+
+typedef struct {
+    const char *text;
+    size_t len;
+    uint64_t hash;
+} NewLine;
+
+// A variable named by the line being compiled
+typedef struct {
+    const char *name;
+    int len;
+} Var;
+
+static const char *statePath = NULL;
+static FILE *saved = NULL;          // the new state, renamed over statePath at the end
+static char *stateData = NULL;
+static StateHeader *old = NULL;
+static OldLine *oldLines = NULL;
+static int nold = 0;
+static NewLine *newLines = NULL;
+static int nnew = 0;
+
+// Leading symbols that have the address they had in the saved compile
+static int agree = 0;
+// Variables whose fact may differ from the saved compile at this line
+static char dirty[TBLSIZE];
+
+static long long reused = 0, compiled = 0, removed = 0;
+
+static void printIncrementalStats(void) {
+    fprintf(stderr, "incremental: %lld lines reused, %lld compiled, %lld removed\n",
+        reused, compiled, removed);
+}
+
+static uint64_t optionsKey(void) {
+    return (pipelineKey() << 16 | (uint64_t)(backend - targets) << 8 | (uint64_t)targetRegs << 1 |
+        (uint64_t)optIsel) ^ rulesKey();
+}
+
+static uint64_t hashLine(const char *s, size_t n) {
+    uint64_t h = 14695981039346656037ull;
+    while (n--) h = (h ^ (unsigned char)*s++) * 1099511628211ull;
+    return h;
+}
+
+static void append(OutBuf *buf, const void *data, size_t n) {
+    if (buf->len + n > buf->cap) {
+        buf->data = (char*)memRealloc(MEM_CODE, buf->data, buf->cap, (buf->len + n) * 2);
+        buf->cap = (buf->len + n) * 2;
+    }
+    memcpy(buf->data + buf->len, data, n);
+    buf->len += n;
+}
+
+static VarState varState(const OldLine *line, int i) {
+    VarState v;
+    memcpy(&v, line->rec + sizeof(LineHeader) + i * sizeof(VarState), sizeof(v));
+    return v;
+}
+
+// Split the state file into lines; a file that does not match is empty
+static void loadState(size_t size) {
+    size_t off = sizeof(StateHeader), rec;
+    int cap = 0;
+
+    old = (StateHeader*)stateData;
+    if (size < sizeof(StateHeader) || memcmp(old->magic, "MCINCR01", 8) != 0 ||
+        memcmp(old->stamp, buildStamp(), sizeof(old->stamp)) != 0 || old->options != optionsKey() ||
+        old->nsym > TBLSIZE) {
+        old = NULL;
+        return;
+    }
+    while (off < size) {
+        OldLine line;
+
+        if (size - off < sizeof(LineHeader)) break;
+        memcpy(&line.h, stateData + off, sizeof(LineHeader));
+        if (line.h.nvar < 0 || line.h.sbBefore < 0) break;
+        rec = sizeof(LineHeader) + line.h.nvar * sizeof(VarState) + line.h.textLen + line.h.codeLen;
+        if (rec > size - off) break;
+        line.rec = stateData + off;
+        line.size = rec;
+        line.text = line.rec + sizeof(LineHeader) + line.h.nvar * sizeof(VarState);
+        line.code = line.text + line.h.textLen;
+        line.hash = hashLine(line.text, line.h.textLen);
+        if (nold == cap) {
+            cap = cap ? cap * 2 : 1024;
+            oldLines = (OldLine*)realloc(oldLines, sizeof(OldLine) * cap);
+        }
+        oldLines[nold++] = line;
+        off += rec;
+    }
+    if (off != size || (uint64_t)nold != old->nlines) {
+        old = NULL;
+        nold = 0;
+    }
+}
+
+void openIncremental(const char *path) {
+    static StateHeader blank;
+    char tmp[4096];
+    struct stat st;
+    int fd;
+
+    statePath = path;
+    atexit(printIncrementalStats);
+    if ((fd = open(path, O_RDONLY)) >= 0) {
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            stateData = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (stateData != (char*)MAP_FAILED) loadState(st.st_size);
+        }
+        close(fd);
+    }
+    // the header is written last, once the lines are known
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    if ((saved = fopen(tmp, "wb")) == NULL || fwrite(&blank, sizeof(blank), 1, saved) != 1) {
+        perror(tmp);
+        exit(2);
+    }
+}
+
+static void readInput(void) {
+    OutBuf in = { NULL, 0, 0 };
+    char chunk[65536], *p, *end;
+    size_t n;
+    int cap = 0;
+
+    while ((n = fread(chunk, 1, sizeof(chunk), stdin)) > 0)
+        append(&in, chunk, n);
+    for (p = in.data; p < in.data + in.len; p = end) {
+        end = (char*)memchr(p, '\n', in.data + in.len - p);
+        end = end ? end + 1 : in.data + in.len;
+        if (nnew == cap) {
+            cap = cap ? cap * 2 : 1024;
+            newLines = (NewLine*)realloc(newLines, sizeof(NewLine) * cap);
+        }
+        newLines[nnew].text = p;
+        newLines[nnew].len = end - p;
+        newLines[nnew++].hash = hashLine(p, end - p);
+    }
+}
+
+static int sameLine(int o, int j) {
+    return oldLines[o].hash == newLines[j].hash && oldLines[o].h.textLen == newLines[j].len &&
+        memcmp(oldLines[o].text, newLines[j].text, newLines[j].len) == 0;
+}
+
+// Myers' O(ND) diff of old lines ao.. ao+n-1 against new lines bo..
+// bo+m-1; sets match for the lines of a shortest edit script, or none
+// if it takes more than MAXEDIT edits
+static void diffRange(int ao, int n, int bo, int m, int *match) {
+    int max = n + m < MAXEDIT ? n + m : MAXEDIT, off = max + 1, d, k, x, y, pk, px, cap = 0;
+    int *v = (int*)malloc(sizeof(int) * (2 * max + 3)), *hist = NULL;
+    const int *pv;
+
+    v[off + 1] = 0;
+    for (d = 0; d <= max; d++) {
+        for (k = -d; k <= d; k += 2) {
+            if (k == -d || (k != d && v[off + k - 1] < v[off + k + 1])) x = v[off + k + 1];
+            else x = v[off + k - 1] + 1;
+            for (y = x - k; x < n && y < m && sameLine(ao + x, bo + y); x++, y++);
+            v[off + k] = x;
+            if (x >= n && y >= m) break;
+        }
+        if (k <= d) break;
+        // the row of every d, for the way back
+        if ((d + 1) * (d + 1) > cap) {
+            cap = 2 * (d + 1) * (d + 1);
+            hist = (int*)realloc(hist, sizeof(int) * cap);
+        }
+        memcpy(hist + d * d, v + off - d, sizeof(int) * (2 * d + 1));
+    }
+    if (d <= max) {
+        for (x = n, y = m; d > 0; d--) {
+            pv = hist + (d - 1) * (d - 1) + (d - 1);
+            k = x - y;
+            pk = k == -d || (k != d && pv[k - 1] < pv[k + 1]) ? k + 1 : k - 1;
+            px = pv[pk];
+            for (; x > px && y > px - pk; x--, y--)
+                match[bo + y - 1] = ao + x - 1;
+            x = px;
+            y = px - pk;
+        }
+        for (; x > 0 && y > 0; x--, y--)
+            match[bo + y - 1] = ao + x - 1;
+    }
+    free(v);
+    free(hist);
+}
+
+// match[j] is the saved line new line j is, or -1 for a new line
+static int diffLines(int *match) {
+    int lo = 0, hiOld = nold, hiNew = nnew, j, n = 0;
+
+    for (j = 0; j < nnew; j++) match[j] = -1;
+    for (; lo < hiOld && lo < hiNew && sameLine(lo, lo); lo++) match[lo] = lo;
+    for (; hiOld > lo && hiNew > lo && sameLine(hiOld - 1, hiNew - 1); hiOld--, hiNew--)
+        match[hiNew - 1] = hiOld - 1;
+    if (lo < hiOld && lo < hiNew) diffRange(lo, hiOld - lo, lo, hiNew - lo, match);
+    for (j = 0; j < nnew; j++) n += match[j] >= 0;
+    return n;
+}
+
+// A saved line can be printed as it is if its variables have the addresses
+// and facts they had, and its new variables get the same addresses
+static int reusable(const OldLine *line) {
+    VarState v;
+
+    for (int i = 0; i < line->h.nvar; i++) {
+        v = varState(line, i);
+        if (v.idx < 0) return 0;
+        if (v.idx >= line->h.sbBefore) {
+            if (sbcount != line->h.sbBefore || agree != sbcount) return 0;
+        } else if (v.idx >= agree || dirty[v.idx]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void reuse(const OldLine *line) {
+    VarState v;
+
+    fwrite(line->code, 1, line->h.codeLen, stdout);
+    for (int i = 0; i < line->h.nvar; i++) {
+        v = varState(line, i);
+        while (sbcount <= v.idx) setvariable(old->names[sbcount]);
+        table[v.idx].known = v.known;
+        table[v.idx].val = v.val;
+        dirty[v.idx] = 0;
+    }
+    fwrite(line->rec, 1, line->size, saved);
+}
+
+// The distinct variables of a line, scanning like the lexer
+static int findVars(const char *s, size_t n, Var **vars, int *cap) {
+    size_t i = 0, len;
+    int nvar = 0, k;
+
+    while (i < n) {
+        if (isdigit((unsigned char)s[i])) {
+            for (len = 0; i + len < n && isdigit((unsigned char)s[i + len]); len++);
+        } else if (isalpha((unsigned char)s[i])) {
+            for (len = 0; i + len < n && (isalnum((unsigned char)s[i + len]) || s[i + len] == '_'); len++);
+            for (k = 0; k < nvar; k++)
+                if ((size_t)(*vars)[k].len == len && strncmp((*vars)[k].name, s + i, len) == 0) break;
+            if (k == nvar && len < MAXLEN) {
+                if (nvar == *cap) {
+                    *cap = *cap ? *cap * 2 : 16;
+                    *vars = (Var*)realloc(*vars, sizeof(Var) * *cap);
+                }
+                (*vars)[nvar].name = s + i;
+                (*vars)[nvar++].len = (int)len;
+            }
+        } else {
+            len = 1;
+        }
+        i += len;
+    }
+    return nvar;
+}
+
+static int lookupVar(const Var *var) {
+    char name[MAXLEN];
+    memcpy(name, var->name, var->len);
+    name[var->len] = '\0';
+    return getvariable(name);
+}
+
+static void saveState(int nlines) {
+    static StateHeader header;
+    char tmp[4096];
+
+    memcpy(header.magic, "MCINCR01", 8);
+    memcpy(header.stamp, buildStamp(), sizeof(header.stamp));
+    header.options = optionsKey();
+    header.nlines = nlines;
+    header.nsym = sbcount;
+    for (int i = 0; i < sbcount; i++)
+        strcpy(header.names[i], table[i].name);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", statePath);
+    if (fseek(saved, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, saved) != 1 ||
+        fclose(saved) != 0 || rename(tmp, statePath) != 0) {
+        perror(statePath);
+    }
+}
+
+// Compile line j into out; an error ends the program, saving the lines
+// before it
+static void compileOrExit(int j, const NewLine *in, OutBuf *out) {
+    jmp_buf jb;
+
+    setOutput(out);
+    errorJump = &jb;
+    if (setjmp(jb) != 0) {
+        setOutput(NULL);
+        fwrite(out->data, 1, out->len, stdout);
+        saveState(j);
+        exit(0);
+    }
+    compileLine(in->text, in->len);
+    errorJump = NULL;
+    setOutput(NULL);
+}
+
+// Compile a changed line or one downstream of a change and save it. A
+// variable becomes dirty if its fact is not the one the saved line left.
+static void compileChanged(int j, const OldLine *line) {
+    static Var *vars = NULL;
+    static int cap = 0;
+    static VarState *prior = NULL, *after = NULL;
+    static int stateCap = 0;
+    const NewLine *in = &newLines[j];
+    LineHeader h;
+    OutBuf out = { NULL, 0, 0 };
+    VarState v;
+    int i, nvar, idx;
+
+    nvar = findVars(in->text, in->len, &vars, &cap);
+    if (nvar > stateCap) {
+        stateCap = nvar;
+        prior = (VarState*)realloc(prior, sizeof(VarState) * stateCap);
+        after = (VarState*)realloc(after, sizeof(VarState) * stateCap);
+    }
+    for (i = 0; i < nvar; i++) {
+        prior[i].idx = idx = lookupVar(&vars[i]);
+        prior[i].known = (int16_t)(idx >= 0 && table[idx].known);
+        prior[i].val = idx >= 0 ? table[idx].val : 0;
+    }
+    h.sbBefore = sbcount;
+    compileOrExit(j, in, &out);
+    fwrite(out.data, 1, out.len, stdout);
+
+    for (i = 0; i < nvar; i++) {
+        // a name the lexer did not read as a variable is never reused
+        if ((after[i].idx = idx = lookupVar(&vars[i])) < 0) {
+            after[i].known = after[i].val = after[i].changed = 0;
+            continue;
+        }
+        after[i].known = (int16_t)table[idx].known;
+        after[i].val = table[idx].val;
+        after[i].changed = prior[i].idx < 0 || prior[i].known != after[i].known ||
+            (prior[i].known && prior[i].val != after[i].val);
+        if (line != NULL) {
+            v = varState(line, i);
+            dirty[idx] = v.idx != idx || v.known != after[i].known || (v.known && v.val != after[i].val);
+        } else if (after[i].changed) {
+            dirty[idx] = 1;
+        }
+    }
+    h.textLen = (uint32_t)in->len;
+    h.codeLen = (uint32_t)out.len;
+    h.nvar = nvar;
+    fwrite(&h, sizeof(h), 1, saved);
+    fwrite(after, sizeof(VarState), nvar, saved);
+    fwrite(in->text, 1, in->len, saved);
+    fwrite(out.data, 1, out.len, saved);
+    freeOutput(&out);
+}
+
+// The variables a removed line wrote may now hold other facts
+static void removeLine(const OldLine *line) {
+    VarState v;
+
+    for (int i = 0; i < line->h.nvar; i++) {
+        v = varState(line, i);
+        if (v.changed && v.idx >= 0) dirty[v.idx] = 1;
+    }
+    removed++;
+}
+
+void compileIncremental(void) {
+    long long start = traceClock();
+    int *match, j, o = 0, nmatched;
+    OldLine *line;
+
+    readInput();
+    traceSpan("readInput", start, "lines", nnew);
+    start = traceClock();
+    match = (int*)malloc(sizeof(int) * (nnew + 1));
+    nmatched = diffLines(match);
+    traceSpan("diff", start, "matched", nmatched);
+
+    start = traceClock();
+    for (j = 0; j < nnew; j++) {
+        // symbols are only ever added, so the prefix that agrees can grow
+        // only while it covers the whole table
+        while (old != NULL && agree < sbcount && (uint64_t)agree < old->nsym &&
+            strcmp(table[agree].name, old->names[agree]) == 0) {
+            agree++;
+        }
+        if (match[j] >= 0) {
+            for (; o < match[j]; o++) removeLine(&oldLines[o]);
+            line = &oldLines[o++];
+        } else {
+            line = NULL;
+        }
+        if (line != NULL && reusable(line)) {
+            reuse(line);
+            reused++;
+        } else {
+            compileChanged(j, line);
+            compiled++;
+        }
+    }
+    for (; o < nold; o++) removeLine(&oldLines[o]);
+    traceSpan("compileLines", start, "compiled", compiled);
+    start = traceClock();
+    saveState(nnew);
+    traceSpan("saveState", start, NULL, 0);
+    endProgram();
+    exit(0);
+}
@@ -0,0 +1,14 @@
+#ifndef __INCR__
+#define __INCR__
+
+// Read the state an earlier incremental compile left at path; a missing
+// file or one from another build or other options is an empty state
+extern void openIncremental(const char *path);
+
+// Compile stdin against the saved state: lines that did not change and
+// read no variable a changed line wrote print their saved code, the
+// others are compiled. Saves the new state and exits like statement does
+// at the end of input.
+extern void compileIncremental(void);
+
+#endif // __INCR__
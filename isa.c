@@ -0,0 +1,162 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "isa.h"
+
+const char *opcodeName[OPCOUNT] = {
+    "MOV", "ADD", "SUB", "MUL", "DIV", "AND", "OR", "XOR", "INC", "DEC",
+    "VLOAD", "VSTORE", "VADD", "VSUB", "VMUL", "VAND", "VOR", "VXOR", "EXIT"
+};
+
+static int isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\0';
+}
+
+// Parse rN, vN, <const> or [addr]; return where the operand ends or NULL
+static const char *parseOperand(const char *p, Operand *opnd) {
+    char *end;
+    long long v;
+
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == 'r' && isdigit((unsigned char)p[1])) {
+        v = strtoll(p + 1, &end, 10);
+        if (v >= MAXREGS) return NULL;
+        opnd->kind = OPND_REG;
+    } else if (*p == 'v' && isdigit((unsigned char)p[1])) {
+        v = strtoll(p + 1, &end, 10);
+        if (v >= MAXVREGS) return NULL;
+        opnd->kind = OPND_VREG;
+    } else if (*p == '[') {
+        v = strtoll(p + 1, &end, 10);
+        if (end == p + 1 || *end != ']') return NULL;
+        end++;
+        opnd->kind = OPND_MEM;
+    } else if (isdigit((unsigned char)p[0]) ||
+               (p[0] == '-' && isdigit((unsigned char)p[1]))) {
+        v = strtoll(p, &end, 10);
+        opnd->kind = OPND_IMM;
+    } else {
+        opnd->kind = OPND_NONE;
+        opnd->val = 0;
+        return p;
+    }
+    if (!isBlank(*end)) return NULL;
+    opnd->val = (int)(unsigned int)v;   // literals wrap to 32 bits like the target
+    return end;
+}
+
+// Check the operand forms accepted by each opcode
+static int validForm(const Instr *ins) {
+    OperandKind d = ins->dst.kind, s = ins->src.kind;
+
+    switch (ins->op) {
+    case OP_MOV:
+        return (d == OPND_REG && s != OPND_NONE) || (d == OPND_MEM && s == OPND_REG);
+    case OP_EXIT:
+        return d == OPND_IMM && s == OPND_NONE;
+    case OP_INC:
+    case OP_DEC:
+        return (d == OPND_REG || d == OPND_MEM) && s == OPND_NONE;
+    case OP_VLOAD:
+        return d == OPND_VREG && s == OPND_MEM;
+    case OP_VSTORE:
+        return d == OPND_MEM && s == OPND_VREG;
+    case OP_VADD:
+    case OP_VSUB:
+    case OP_VMUL:
+    case OP_VAND:
+    case OP_VOR:
+    case OP_VXOR:
+        return d == OPND_VREG && s == OPND_VREG;
+    default:
+        // OP r r, OP r imm, OP r [addr] and OP [addr] r
+        return (d == OPND_REG && s != OPND_NONE) || (d == OPND_MEM && s == OPND_REG);
+    }
+}
+
+int parseInstr(const char *line, Instr *ins) {
+    char name[8];
+    int i = 0, op;
+    const char *p = line;
+
+    while (*p == ' ' || *p == '\t') p++;
+    while (isupper((unsigned char)*p) && i < (int)sizeof(name) - 1)
+        name[i++] = *p++;
+    name[i] = '\0';
+    if (!isBlank(*p)) return 0;
+
+    for (op = 0; op < OPCOUNT; op++)
+        if (strcmp(name, opcodeName[op]) == 0) break;
+    if (op == OPCOUNT) return 0;
+    ins->op = (Opcode)op;
+
+    if ((p = parseOperand(p, &ins->dst)) == NULL) return 0;
+    if ((p = parseOperand(p, &ins->src)) == NULL) return 0;
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+    if (*p != '\0') return 0;
+    return validForm(ins);
+}
+
+static char *formatOperand(const Operand *opnd, char *buf) {
+    switch (opnd->kind) {
+    case OPND_REG: return buf + sprintf(buf, " r%d", opnd->val);
+    case OPND_IMM: return buf + sprintf(buf, " %d", opnd->val);
+    case OPND_MEM: return buf + sprintf(buf, " [%d]", opnd->val);
+    case OPND_VREG: return buf + sprintf(buf, " v%d", opnd->val);
+    default: return buf;
+    }
+}
+
+void formatInstr(const Instr *ins, char *buf) {
+    buf += sprintf(buf, "%s", opcodeName[ins->op]);
+    buf = formatOperand(&ins->dst, buf);
+    formatOperand(&ins->src, buf);
+}
+
+// The base machine, and a load/store variant with more registers and
+// 64-bit words that only moves data between registers and memory with MOV
+const Target targets[] = {
+    { "mini",
+      { "MOV", "ADD", "SUB", "MUL", "DIV", "AND", "OR", "XOR", "INC", "DEC",
+        "VLOAD", "VSTORE", "VADD", "VSUB", "VMUL", "VAND", "VOR", "VXOR", "EXIT" },
+      // 4 per instruction plus its cycles under the default simulator
+      // latencies (LOAD 4, STORE 1, ALU 1)
+      { 8, 5, 5, 5, 5, 5, 9, 10, 10, 5, 5 },
+      4, 8 },
+    { "mini-ls",
+      { "MOV", "ADD", "SUB", "MUL", "DIV", "AND", "OR", "XOR", NULL, NULL,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, "EXIT" },
+      { 8, 5, 5, 5, 5, 5, 0, 0, 0, 0, 5 },
+      8, 16 },
+};
+const int ntargets = sizeof(targets) / sizeof(targets[0]);
+
+const Target *backend = &targets[0];
+
+const Target *findTarget(const char *name) {
+    for (int i = 0; i < ntargets; i++)
+        if (strcmp(targets[i].name, name) == 0) return &targets[i];
+    return NULL;
+}
+
+Form formOf(const Instr *ins) {
+    OperandKind d = ins->dst.kind, s = ins->src.kind;
+
+    if (ins->op == OP_EXIT) return FORM_EXIT;
+    if (isVectorOp(ins->op)) return FORM_VECTOR;
+    if (ins->op == OP_MOV) {
+        if (d == OPND_MEM) return FORM_STORE;
+        if (s == OPND_MEM) return FORM_LOAD;
+        return s == OPND_IMM ? FORM_IMM : FORM_COPY;
+    }
+    if (ins->op == OP_INC || ins->op == OP_DEC) return d == OPND_MEM ? FORM_INC : FORM_RI;
+    if (d == OPND_MEM) return FORM_MR;
+    if (s == OPND_MEM) return FORM_RM;
+    return s == OPND_IMM ? FORM_RI : FORM_RR;
+}
+
+int targetAccepts(const Target *target, const Instr *ins) {
+    return target->mnemonic[ins->op] != NULL && target->cost[formOf(ins)] != 0;
+}
@@ -0,0 +1,96 @@
+#ifndef __ISA__
+#define __ISA__
+
+#define MAXREGS 64
+
+// Vector extension: MAXVREGS registers of VLANES 32-bit lanes
+#define MAXVREGS 8
+#define VLANES 4
+
+// Opcodes of the pseudo-assembly printed by the code generator
+typedef enum {
+    OP_MOV, OP_ADD, OP_SUB, OP_MUL, OP_DIV,
+    OP_AND, OP_OR, OP_XOR, OP_INC, OP_DEC,
+    OP_VLOAD, OP_VSTORE, OP_VADD, OP_VSUB, OP_VMUL, OP_VAND, OP_VOR, OP_VXOR,
+    OP_EXIT,
+    OPCOUNT
+} Opcode;
+
+// Operand kinds: rN, <const>, [addr], vN
+typedef enum {
+    OPND_NONE, OPND_REG, OPND_IMM, OPND_MEM, OPND_VREG
+} OperandKind;
+
+typedef struct {
+    OperandKind kind;
+    int val;    // register number, immediate value or byte address
+} Operand;
+
+// Structure of one instruction
+typedef struct {
+    Opcode op;
+    Operand dst;
+    Operand src;
+} Instr;
+
+// Mnemonic of each opcode
+extern const char *opcodeName[OPCOUNT];
+
+// Operand forms of the instructions, the unit a target supports and
+// prices instructions in
+typedef enum {
+    FORM_LOAD,      // MOV r [addr]
+    FORM_IMM,       // MOV r imm
+    FORM_COPY,      // MOV r r
+    FORM_STORE,     // MOV [addr] r
+    FORM_RR,        // OP r r
+    FORM_RI,        // OP r imm, INC r, DEC r
+    FORM_RM,        // OP r [addr]
+    FORM_MR,        // OP [addr] r
+    FORM_INC,       // INC [addr], DEC [addr]
+    FORM_VECTOR,    // the vector instructions
+    FORM_EXIT,      // EXIT imm
+    FORMCOUNT
+} Form;
+
+// Description of a target. The code generator prints mnemonic[op] for
+// op and only uses the forms the target has; variable i lives at
+// wordSize * i. The simulator runs the code of every target.
+typedef struct {
+    const char *name;
+    const char *mnemonic[OPCOUNT];  // NULL if the target lacks the opcode
+    int cost[FORMCOUNT];            // cost of a form for -fisel, 0 if the target lacks it
+    int wordSize;                   // bytes between two variables
+    int regs;                       // general registers, the default of -fregs
+} Target;
+
+// The targets, the first is the default
+extern const Target targets[];
+extern const int ntargets;
+
+// Target the code is generated for, set with -ftarget=NAME
+extern const Target *backend;
+
+// Find a target by name, NULL if there is none
+extern const Target *findTarget(const char *name);
+
+// Form of an instruction, FORMCOUNT if it has none
+extern Form formOf(const Instr *ins);
+
+// Check that target has the opcode and the form of an instruction
+extern int targetAccepts(const Target *target, const Instr *ins);
+
+#define hasForm(form) (backend->cost[form] != 0)
+#define varAddress(idx) (backend->wordSize * (idx))
+
+// VLOAD vN [addr] and VSTORE [addr] vN move the VLANES words from addr
+// up; the other vector ops work lane by lane on two vector registers
+#define isVectorOp(op) ((op) >= OP_VLOAD && (op) <= OP_VXOR)
+
+// Parse one line of pseudo-assembly, return 0 if it is not an instruction
+extern int parseInstr(const char *line, Instr *ins);
+
+// Print an instruction into buf the same way the code generator does
+extern void formatInstr(const Instr *ins, char *buf);
+
+#endif // __ISA__
@@ -0,0 +1,234 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "isel.h"
+#include "codeGen.h"
+
+int optIsel = 0;
+
+// Tiles of a binary node, kept in its val field by label
+typedef enum {
+    RULE_RR,        // OP l r, both operands in registers
+    RULE_RI,        // OP l imm
+    RULE_RM,        // OP l [addr], or the register of a promoted variable
+    RULE_IR,        // commuted: OP r imm
+    RULE_MR         // commuted: OP r [addr]
+} Rule;
+
+static int promoted(Tree *t, int i) {
+    int varidx = getvariable(nodeLexeme(t, i));
+    return varidx != -1 && table[varidx].reg >= 0;
+}
+
+static int assigns(Tree *t, int i, const char *name) {
+    for (int j = firstNode(t, i); j <= i; j++)
+        if ((t->node[j].flags & NODE_TARGET) && strcmp(nodeLexeme(t, j), name) == 0) return 1;
+    return 0;
+}
+
+// A left operand that may be read after the right one is computed
+static int pure(Tree *t, int i, int other) {
+    if (t->node[i].data == INT) return 1;
+    return t->node[i].data == ID && getvariable(nodeLexeme(t, i)) != -1 && !assigns(t, other, nodeLexeme(t, i));
+}
+
+static int commutative(Opcode op) {
+    return op == OP_ADD || op == OP_MUL || op == OP_AND || op == OP_OR || op == OP_XOR;
+}
+
+// Cost of a variable used as the source operand of an ALU op, 0 if the
+// target cannot read it in place
+static int memCost(Tree *t, int i) {
+    return backend->cost[promoted(t, i) ? FORM_RR : FORM_RM];
+}
+
+// Cost of adding a register to a variable in memory
+static int updateCost(void) {
+    if (hasForm(FORM_MR)) return backend->cost[FORM_MR];
+    return backend->cost[FORM_LOAD] + backend->cost[FORM_RR] + backend->cost[FORM_STORE];
+}
+
+// A constant added to a promoted variable in place, or with INC/DEC
+static int inPlace(Tree *t, int i) {
+    BTNode *node = &t->node[i];
+    int varidx = getvariable(nodeLexeme(t, node->left));
+
+    if (varidx != -1 && table[varidx].reg >= 0) return hasForm(FORM_RI);
+    // loaded, updated with the constant and stored back
+    if (!hasForm(FORM_MR)) return hasForm(FORM_RI);
+    return strcmp(nodeLexeme(t, node->right), "1") == 0 && hasForm(FORM_INC) &&
+        backend->mnemonic[node->op == OP_ADD ? OP_INC : OP_DEC] != NULL;
+}
+
+// Choose the cheapest tile of every binary node bottom up, leaving the
+// cost of computing each node into a register in cost. A leaf a tile
+// reads in place is marked NODE_SKIP.
+static void label(Tree *t, int *cost) {
+    int i, l, r, best, c;
+
+    for (i = 0; i < t->n; i++) {
+        BTNode *node = &t->node[i];
+        node->flags &= ~NODE_SKIP;
+        switch (node->data) {
+        case ID:
+            cost[i] = backend->cost[promoted(t, i) ? FORM_COPY : FORM_LOAD];
+            break;
+        case INT:
+            cost[i] = backend->cost[FORM_IMM];
+            break;
+        case ASSIGN:
+            cost[i] = cost[node->right] + backend->cost[FORM_STORE];
+            break;
+        case ADDSUB_ASSIGN:
+        case UNARY:
+            if (t->node[node->right].data == INT) {
+                cost[i] = (hasForm(FORM_INC) ? backend->cost[FORM_INC] : updateCost()) + backend->cost[FORM_LOAD];
+                if (inPlace(t, i)) t->node[node->right].flags |= NODE_SKIP;
+            }
+            else cost[i] = cost[node->right] + updateCost() + backend->cost[FORM_LOAD];
+            break;
+        default:
+            l = cost[node->left];
+            r = cost[node->right];
+            node->val = RULE_RR;
+            best = l + r + backend->cost[FORM_RR];
+            if (t->node[node->right].data == INT && hasForm(FORM_RI) && (c = l + backend->cost[FORM_RI]) <= best) {
+                node->val = RULE_RI;
+                best = c;
+            }
+            if (t->node[node->right].data == ID && memCost(t, node->right) && (c = l + memCost(t, node->right)) <= best) {
+                node->val = RULE_RM;
+                best = c;
+            }
+            if (commutative((Opcode)node->op) && pure(t, node->left, node->right)) {
+                if (t->node[node->left].data == INT && hasForm(FORM_RI) && (c = r + backend->cost[FORM_RI]) < best) {
+                    node->val = RULE_IR;
+                    best = c;
+                }
+                if (t->node[node->left].data == ID && memCost(t, node->left) && (c = r + memCost(t, node->left)) < best) {
+                    node->val = RULE_MR;
+                    best = c;
+                }
+            }
+            if (node->val == RULE_RI || node->val == RULE_RM) t->node[node->right].flags |= NODE_SKIP;
+            else if (node->val == RULE_IR || node->val == RULE_MR) t->node[node->left].flags |= NODE_SKIP;
+            cost[i] = best;
+            break;
+        }
+    }
+}
+
+// OP reg with a variable as the source operand
+static void memOperand(const char *op, int reg, Tree *t, int i) {
+    int varidx = getvariable(nodeLexeme(t, i));
+
+    if (varidx == -1) error(UNDEFVAR);
+    if (table[varidx].reg >= 0)
+        emit("%s r%d r%d\n", op, reg, table[varidx].reg);
+    else
+        emit("%s r%d [%d]\n", op, reg, varAddress(varidx));
+}
+
+// Emit the chosen tiles in postfix order; the value of every node is
+// left in reg, the one of the root only if it is needed
+static int gen(Tree *t, int *reg) {
+    int i, rreg, varidx, held, copy, skip, root = t->n - 1;
+    const char *op;
+
+    for (i = 0; i <= root; i++) {
+        BTNode *node = &t->node[i];
+        reg[i] = -1;
+        if (node->flags & NODE_SKIP) continue;
+        switch (node->data) {
+        case ID:
+            if (node->flags & NODE_ASSIGNED) {
+                if (getvariable(nodeLexeme(t, i)) == -1) setvariable(nodeLexeme(t, i));
+            } else if (node->flags & NODE_UPDATED) {
+                if (getvariable(nodeLexeme(t, i)) == -1) error(UNDEFVAR);
+            }
+            else reg[i] = loadLeaf(t, i);
+            break;
+
+        case INT:
+            reg[i] = loadLeaf(t, i);
+            break;
+
+        case ASSIGN:
+            varidx = getvariable(nodeLexeme(t, node->left));
+            reg[i] = reg[node->right];
+            if (table[varidx].reg >= 0)
+                emit("%s r%d r%d\n", backend->mnemonic[OP_MOV], table[varidx].reg, reg[i]);
+            else
+                emit("%s [%d] r%d\n", backend->mnemonic[OP_MOV], varAddress(varidx), reg[i]);
+            break;
+
+        case ADDSUB_ASSIGN:
+        case UNARY:
+            varidx = getvariable(nodeLexeme(t, node->left));
+            op = backend->mnemonic[node->op];
+            held = copy = table[varidx].reg;
+            skip = t->node[node->right].flags & NODE_SKIP;
+            if (skip && held >= 0) {
+                emit("%s r%d %s\n", op, held, nodeLexeme(t, node->right));
+            } else if (skip && hasForm(FORM_MR)) {
+                emit("%s [%d]\n", backend->mnemonic[node->op == OP_ADD ? OP_INC : OP_DEC], varAddress(varidx));
+            } else if (held < 0 && !hasForm(FORM_MR)) {
+                // load, update and store back; the value is copied from there
+                copy = allocateRegister();
+                emit("%s r%d [%d]\n", backend->mnemonic[OP_MOV], copy, varAddress(varidx));
+                if (skip) emit("%s r%d %s\n", op, copy, nodeLexeme(t, node->right));
+                else emit("%s r%d r%d\n", op, copy, reg[node->right]);
+                emit("%s [%d] r%d\n", backend->mnemonic[OP_MOV], varAddress(varidx), copy);
+                freeRegister();
+                if (!skip) freeRegister();
+            } else {
+                rreg = reg[node->right];
+                if (held >= 0) emit("%s r%d r%d\n", op, held, rreg);
+                else emit("%s [%d] r%d\n", op, varAddress(varidx), rreg);
+                freeRegister();
+            }
+            // the value of a statement is not used, only the stores it makes
+            if (i == root) break;
+            reg[i] = allocateRegister();
+            if (copy < 0) emit("%s r%d [%d]\n", backend->mnemonic[OP_MOV], reg[i], varAddress(varidx));
+            else if (copy != reg[i]) emit("%s r%d r%d\n", backend->mnemonic[OP_MOV], reg[i], copy);
+            break;
+
+        default:
+            op = backend->mnemonic[node->op];
+            switch (node->val) {
+            case RULE_RI:
+                reg[i] = reg[node->left];
+                emit("%s r%d %s\n", op, reg[i], nodeLexeme(t, node->right));
+                break;
+            case RULE_RM:
+                reg[i] = reg[node->left];
+                memOperand(op, reg[i], t, node->right);
+                break;
+            case RULE_IR:
+                reg[i] = reg[node->right];
+                emit("%s r%d %s\n", op, reg[i], nodeLexeme(t, node->left));
+                break;
+            case RULE_MR:
+                reg[i] = reg[node->right];
+                memOperand(op, reg[i], t, node->left);
+                break;
+            default:
+                reg[i] = reg[node->left];
+                emit("%s r%d r%d\n", op, reg[i], reg[node->right]);
+                freeRegister();
+                break;
+            }
+            break;
+        }
+    }
+    return reg[root];
+}
+
+void selectTree(Tree *t) {
+    int *scratch = (int*)treeScratch(t, 2 * sizeof(int));
+
+    label(t, scratch);
+    if (gen(t, scratch + t->n) == -1) allocateRegister();
+}
@@ -0,0 +1,14 @@
+#ifndef __ISEL__
+#define __ISEL__
+
+#include "parser.h"
+
+// Enabled with -fisel: use immediate and memory operands, ADD [addr] r
+// for += and -=, and INC/DEC [addr] for ++ and --
+extern int optIsel;
+
+// Generate the code of a statement with the cheapest tiling of its tree;
+// an extended counterpart of evaluateTree
+extern void selectTree(Tree *t);
+
+#endif // __ISEL__
@@ -0,0 +1,121 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include "latency.h"
+
+// Log-linear buckets like an HDR histogram: below 2^SUBBITS ns one per
+// ns, above it 2^(SUBBITS-1) per power of two, so a bucket is within
+// 1/64 (under 2%) of its values. MAXBITS bounds the values at about 18
+// minutes.
+#define SUBBITS 7
+#define MAXBITS 40
+#define NBUCKETS ((MAXBITS - SUBBITS + 2) << (SUBBITS - 1))
+
+// Statement sizes in tokens, the newline included; the last row is all
+#define NSIZES 4
+static const long long sizeLimit[NSIZES] = { 8, 32, 128, -1 };
+static const char *sizeName[NSIZES + 1] = { "1-8", "9-32", "33-128", "129+", "all" };
+static const char *phaseName[LATPHASES] = { "total", "parse", "passes", "codegen", "output" };
+
+typedef struct {
+    long long count;
+    long long max;
+    long long bucket[NBUCKETS];
+} Histogram;
+
+int latencyReport = 0;
+
+static Histogram hist[LATPHASES][NSIZES + 1];
+static volatile sig_atomic_t requested = 0;
+
+static int bucketOf(long long v) {
+    int e = 0;
+
+    if (v < (1 << SUBBITS)) return (int)v;
+    if (v >= 1LL << MAXBITS) v = (1LL << MAXBITS) - 1;
+    while (v >> (e + SUBBITS)) e++;
+    // v >> e is in [2^(SUBBITS-1), 2^SUBBITS)
+    return e * (1 << (SUBBITS - 1)) + (int)(v >> e);
+}
+
+// Highest value that falls in bucket b
+static long long bucketTop(int b) {
+    int half = 1 << (SUBBITS - 1), e;
+
+    if (b < (1 << SUBBITS)) return b;
+    e = b / half - 1;
+    return ((long long)(b % half + half + 1) << e) - 1;
+}
+
+static void add(Histogram *h, long long v) {
+    if (v < 0) v = 0;
+    h->count++;
+    if (v > h->max) h->max = v;
+    h->bucket[bucketOf(v)]++;
+}
+
+// Smallest value that at least permille / 1000 of the values are at most
+static long long percentile(const Histogram *h, int permille) {
+    long long want = (h->count * permille + 999) / 1000, seen = 0;
+    int b;
+
+    for (b = 0; b < NBUCKETS; b++) {
+        seen += h->bucket[b];
+        if (seen >= want) break;
+    }
+    return bucketTop(b) < h->max ? bucketTop(b) : h->max;
+}
+
+static void printLatency(void) {
+    const Histogram *h;
+    int p, s, i;
+
+    fprintf(stderr, "latency (us)  tokens       count       p50       p99     p99.9       max\n");
+    for (p = 0; p < LATPHASES; p++)
+        for (i = 0; i <= NSIZES; i++) {
+            // the sizes of a phase follow its total, with nothing if one size has it all
+            s = i == 0 ? NSIZES : i - 1;
+            h = &hist[p][s];
+            if (h->count == 0 || (s < NSIZES && h->count == hist[p][NSIZES].count)) continue;
+            fprintf(stderr, "%-13s %-6s %11lld %9.2f %9.2f %9.2f %9.2f\n",
+                s == NSIZES ? phaseName[p] : "", sizeName[s], h->count,
+                percentile(h, 500) / 1000.0, percentile(h, 990) / 1000.0,
+                percentile(h, 999) / 1000.0, h->max / 1000.0);
+        }
+}
+
+static void requestReport(int sig) {
+    (void)sig;
+    requested = 1;
+}
+
+void openLatency(void) {
+    latencyReport = 1;
+    atexit(printLatency);
+    signal(SIGUSR1, requestReport);
+}
+
+long long latencyClock(void) {
+    struct timespec ts;
+
+    if (!latencyReport) return 0;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void recordLatency(const long long *stamp, long long tokens) {
+    int p, s;
+
+    for (s = 0; s < NSIZES - 1 && tokens > sizeLimit[s]; s++);
+    for (p = 0; p < LATPHASES; p++) {
+        long long v = p == LAT_TOTAL ? stamp[LATPHASES - 1] - stamp[LAT_TOTAL] : stamp[p] - stamp[p - 1];
+        add(&hist[p][s], v);
+        add(&hist[p][NSIZES], v);
+    }
+    if (requested) {
+        requested = 0;
+        printLatency();
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef __LATENCY__
+#define __LATENCY__
+
+// Enabled with -flatency: per-statement latency histograms, printed to
+// stderr at exit and when the process gets SIGUSR1
+extern int latencyReport;
+
+// Phases of a statement; the stamps of a statement are the times each
+// phase ended, LAT_TOTAL holding when its first token was read
+typedef enum {
+    LAT_TOTAL,      // first token read to output flushed
+    LAT_PARSE,      // the tokens and the tree
+    LAT_PASSES,     // the tree passes
+    LAT_CODEGEN,    // printPrefix and the code
+    LAT_OUTPUT,     // flushing stdout
+    LATPHASES
+} LatencyPhase;
+
+// Install the exit and signal handlers
+extern void openLatency(void);
+
+// Current time in ns, 0 when -flatency is off
+extern long long latencyClock(void);
+
+// Add a statement of tokens tokens to the histograms; a report asked for
+// with SIGUSR1 is printed now
+extern void recordLatency(const long long *stamp, long long tokens);
+
+#endif // __LATENCY__
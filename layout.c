@@ -0,0 +1,256 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "layout.h"
+#include "codeGen.h"
+#include "passes.h"
+#include "trace.h"
+
+#define HOTSHARE 90     // percent of the accesses made by the hot variables
+
+int optLayout = 0;
+const char *layoutMap = NULL;
+
+static Tree **trees = NULL;
+static int ntrees = 0;
+
+// Co-access graph: the accesses of every variable, and the statements
+// naming both of two variables
+static long long uses[TBLSIZE];
+static int affinity[TBLSIZE][TBLSIZE];
+
+// Clusters of variables that go in one line, as a union-find forest
+static int parent[TBLSIZE];
+static int size[TBLSIZE];
+
+// New index of every variable, and the variable at every new index
+static int slot[TBLSIZE];
+static int owner[TBLSIZE];
+
+typedef struct {
+    int weight;
+    int a, b;
+} Edge;
+
+// Add the accesses of a statement and an edge between every two
+// variables it names
+static void countAccesses(Tree *t) {
+    int named[TBLSIZE], n = 0, i, j, idx;
+
+    for (i = 0; i < t->n; i++) {
+        if (t->node[i].data != ID || (idx = getvariable(nodeLexeme(t, i))) == -1) continue;
+        uses[idx]++;
+        for (j = 0; j < n && named[j] != idx; j++);
+        if (j == n) named[n++] = idx;
+    }
+    for (i = 0; i < n; i++)
+        for (j = i + 1; j < n; j++) {
+            affinity[named[i]][named[j]]++;
+            affinity[named[j]][named[i]]++;
+        }
+}
+
+static int find(int v) {
+    while (parent[v] != v) v = parent[v];
+    return v;
+}
+
+static int heavier(const void *x, const void *y) {
+    const Edge *a = (const Edge*)x, *b = (const Edge*)y;
+    if (a->weight != b->weight) return b->weight - a->weight;
+    if (a->a != b->a) return a->a - b->a;
+    return a->b - b->b;
+}
+
+// Merge the clusters joined by the heaviest edges first while they fit
+// in a line (Pettis and Hansen); x, y and z start as one cluster
+static void buildClusters(void) {
+    static Edge edges[TBLSIZE * TBLSIZE / 2];
+    int n = 0, i, j, a, b;
+
+    for (i = 0; i < sbcount; i++) {
+        parent[i] = i;
+        size[i] = 1;
+    }
+    parent[1] = parent[2] = 0;
+    size[0] = 3;
+    for (i = 0; i < sbcount; i++)
+        for (j = i + 1; j < sbcount; j++)
+            if (affinity[i][j] > 0) {
+                edges[n].weight = affinity[i][j];
+                edges[n].a = i;
+                edges[n++].b = j;
+            }
+    qsort(edges, n, sizeof(Edge), heavier);
+    for (i = 0; i < n; i++) {
+        a = find(edges[i].a);
+        b = find(edges[i].b);
+        if (a == b || size[a] + size[b] > optLayout) continue;
+        // the cluster of x, y and z keeps its root
+        if (b == 0) {
+            b = a;
+            a = 0;
+        }
+        parent[b] = a;
+        size[a] += size[b];
+    }
+}
+
+// Place the variables of cluster c, hottest first, from index at
+static int placeCluster(int c, int at) {
+    int i, best;
+
+    while (1) {
+        best = -1;
+        for (i = 0; i < sbcount; i++)
+            if (slot[i] < 0 && find(i) == c && (best < 0 || uses[i] > uses[best])) best = i;
+        if (best < 0) return at;
+        while (owner[at] != -1) at++;
+        slot[best] = at;
+        owner[at] = best;
+    }
+}
+
+// Words of line l not taken yet
+static int roomIn(int l) {
+    int free = 0;
+    for (int i = l * optLayout; i < (l + 1) * optLayout; i++)
+        free += owner[i] == -1;
+    return free;
+}
+
+// Fill the lines: the cluster of x, y and z in line 0, then the others,
+// hottest first, each in the line with room whose variables it is used
+// with most, or the first line with room
+static void placeClusters(void) {
+    long long heat[TBLSIZE] = { 0 };
+    int nlines = TBLSIZE / optLayout, done[TBLSIZE] = { 0 };
+    int i, c, l, w, best, bestw, i0;
+
+    for (i = 0; i < TBLSIZE; i++)
+        slot[i] = owner[i] = -1;
+    for (i = 0; i < 3; i++)
+        slot[i] = owner[i] = i;
+    placeCluster(0, 0);
+    done[0] = 1;
+    for (i = 0; i < sbcount; i++)
+        heat[find(i)] += uses[i];
+    while (1) {
+        for (c = -1, i = 0; i < sbcount; i++)
+            if (find(i) == i && !done[i] && (c < 0 || heat[i] > heat[c])) c = i;
+        if (c < 0) break;
+        done[c] = 1;
+        best = -1;
+        bestw = -1;
+        for (l = 0; l < nlines; l++) {
+            if (roomIn(l) < size[c]) continue;
+            for (w = 0, i0 = l * optLayout; i0 < (l + 1) * optLayout; i0++)
+                if (owner[i0] != -1) {
+                    for (i = 0; i < sbcount; i++)
+                        if (find(i) == c) w += affinity[i][owner[i0]];
+                }
+            if (w > bestw) {
+                best = l;
+                bestw = w;
+            }
+        }
+        // no line has room for the whole cluster: any free words will do
+        placeCluster(c, best >= 0 ? best * optLayout : 0);
+    }
+}
+
+// Renumber the symbol table by the layout; the unused indices get
+// entries no identifier matches
+static void relayout(void) {
+    static Symbol old[TBLSIZE];
+    int i, n = 0;
+
+    memcpy(old, table, sizeof(Symbol) * sbcount);
+    for (i = 0; i < TBLSIZE; i++)
+        if (owner[i] != -1) n = i + 1;
+    for (i = 0; i < n; i++) {
+        if (owner[i] != -1) {
+            table[i] = old[owner[i]];
+        } else {
+            table[i].name[0] = '\0';
+            table[i].val = table[i].known = 0;
+            table[i].reg = -1;
+        }
+    }
+    sbcount = n;
+}
+
+// Lines spanned by the first n variables of order, at their old or new index
+static int linesSpanned(const int *order, int n, int moved) {
+    int seen[TBLSIZE] = { 0 }, lines = 0, l;
+
+    for (int i = 0; i < n; i++) {
+        l = (moved ? slot[order[i]] : order[i]) / optLayout;
+        if (!seen[l]) lines++;
+        seen[l] = 1;
+    }
+    return lines;
+}
+
+static int hotter(const void *x, const void *y) {
+    int a = *(const int*)x, b = *(const int*)y;
+    if (uses[a] != uses[b]) return uses[a] < uses[b] ? 1 : -1;
+    return a - b;
+}
+
+static void report(void) {
+    int order[TBLSIZE], n = sbcount, hot = 0, i;
+    long long total = 0, sum = 0;
+    FILE *fp;
+
+    for (i = 0; i < n; i++) {
+        order[i] = i;
+        total += uses[i];
+    }
+    qsort(order, n, sizeof(int), hotter);
+    while (hot < n && sum * 100 < total * HOTSHARE)
+        sum += uses[order[hot++]];
+    fprintf(stderr, "layout: %d variables in %d lines of %d bytes (%d before); the hottest %d, %d%% of %lld accesses, span %d lines (%d before)\n",
+        n, linesSpanned(order, n, 1), backend->wordSize * optLayout, linesSpanned(order, n, 0), hot,
+        total ? (int)(sum * 100 / total) : 0, total, linesSpanned(order, hot, 1), linesSpanned(order, hot, 0));
+
+    if (layoutMap == NULL) return;
+    if ((fp = fopen(layoutMap, "w")) == NULL) {
+        perror(layoutMap);
+        exit(2);
+    }
+    fprintf(fp, "# variable\told address\tnew address\n");
+    for (i = 0; i < n; i++)
+        fprintf(fp, "%s\t%d\t%d\n", table[i].name, varAddress(i), varAddress(slot[i]));
+    fclose(fp);
+}
+
+void compileLaidOut(void) {
+    long long start = traceClock();
+    int resolved, failed = parseProgram(&trees, &ntrees, &resolved), i;
+
+    traceSpan("parseProgram", start, "statements", ntrees);
+    start = traceClock();
+    for (i = 0; i < ntrees; i++)
+        countAccesses(trees[i]);
+    buildClusters();
+    placeClusters();
+    report();
+    relayout();
+    traceSpan("layout", start, "variables", sbcount);
+
+    for (i = 0; i < ntrees; i++) {
+        start = traceClock();
+        resetRegister();
+        compileStatement(trees[i]);
+        freeTree(trees[i]);
+        traceSpan("compileStatement", start, "n", i + 1);
+    }
+    if (failed) {
+        emit("%s 1\n", backend->mnemonic[OP_EXIT]);
+        exit(0);
+    }
+    endProgram();
+    exit(0);
+}
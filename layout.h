@@ -0,0 +1,15 @@
+#ifndef __LAYOUT__
+#define __LAYOUT__
+
+// Enabled with -flayout[=N]: words per cache line of the target, 0 if off
+extern int optLayout;
+
+// Where -flayout-map writes the relocation table, NULL for none
+extern const char *layoutMap;
+
+// Compile the whole program with the variables used together placed in
+// the same cache lines; x, y and z keep their addresses. Prints how many
+// lines the hot variables span to stderr and exits like statement does.
+extern void compileLaidOut(void);
+
+#endif // __LAYOUT__
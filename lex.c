@@ -3,32 +3,69 @@
 #include <string.h>
 #include <ctype.h>
 #include "lex.h"
+#include "trace.h"
+#include "latency.h"
 
 static TokenSet getToken(void);
-static TokenSet curToken = UNKNOWN;
-static char lexeme[MAXLEN];
+static _Thread_local TokenSet curToken = UNKNOWN;
+static _Thread_local char lexeme[MAXLEN];
+
+// Input of the lexer: stdin, or the memory buffer given to setLexBuffer
+static _Thread_local const char *inPtr = NULL;
+static _Thread_local const char *inEnd = NULL;
+
+// Time spent in getToken while tracing, and tokens read
+static _Thread_local long long lexNanos = 0, lexTokens = 0;
+
+// When the current token was read, with -flatency
+static _Thread_local long long tokenStamp = 0;
+
+// Line of the current token and of the next one, counted from 1
+static _Thread_local int tokenLine = 1, nextLine = 1;
+
+static int nextChar(void) {
+    if (inPtr == NULL) return fgetc(stdin);
+    return inPtr < inEnd ? (unsigned char)*inPtr++ : EOF;
+}
+
+// Push back the last character like ungetc, which ignores EOF
+static void unreadChar(int c) {
+    if (c == EOF) return;
+    if (inPtr == NULL) ungetc(c, stdin);
+    else inPtr--;
+}
+
+void setLexBuffer(const char *buf, size_t len) {
+    inPtr = buf;
+    inEnd = buf + len;
+    curToken = UNKNOWN;
+}
+
+int lexAtEnd(void) {
+    return inPtr != NULL && inPtr == inEnd;
+}
 
 TokenSet getToken(void) {
     int i = 0;
     char c = '\0';
-    while ((c = fgetc(stdin)) == ' ' || c == '\t');
+    while ((c = nextChar()) == ' ' || c == '\t');
 
     if (isdigit(c)) {
         lexeme[0] = c;
-        c = fgetc(stdin);
+        c = nextChar();
         i = 1;
         while (isdigit(c) && i < MAXLEN) {
             lexeme[i] = c;
             ++i;
-            c = fgetc(stdin);
+            c = nextChar();
         }
-        ungetc(c, stdin);
+        unreadChar(c);
         lexeme[i] = '\0';
         return INT;
     }
     else if (c == '+' || c == '-') {
         lexeme[0] = c;
-		c = fgetc(stdin);
+		c = nextChar();
 		if (c == '=') {
 			lexeme[1] = c;
 			lexeme[2] = '\0';
@@ -38,7 +75,7 @@ TokenSet getToken(void) {
 			lexeme[2] = '\0';
 			return UNARY;
         } else {
-            ungetc(c, stdin);
+            unreadChar(c);
             lexeme[1] = '\0';
             return ADDSUB;
         }
@@ -62,14 +99,14 @@ TokenSet getToken(void) {
     } 
     else if (isalpha(c)) {
         lexeme[0] = c;
-        c = fgetc(stdin);
+        c = nextChar();
         i = 1;
         while ((isalpha(c) || isdigit(c) || c=='_') && i < MAXLEN) {
             lexeme[i] = c;
             ++i;
-            c = fgetc(stdin);
+            c = nextChar();
         }
-        ungetc(c, stdin);
+        unreadChar(c);
         lexeme[i] = '\0';
         return ID;
 	}
@@ -94,7 +131,38 @@ TokenSet getToken(void) {
 }
 
 void advance(void) {
-    curToken = getToken();
+    long long start;
+    tokenLine = nextLine;
+    if (tracing) {
+        start = traceClock();
+        curToken = getToken();
+        lexNanos += traceClock() - start;
+    }
+    else curToken = getToken();
+    if (latencyReport) tokenStamp = latencyClock();
+    lexTokens++;
+    if (curToken == END) nextLine++;
+}
+
+long long tokenClock(void) {
+    return tokenStamp;
+}
+
+long long tokensRead(void) {
+    return lexTokens;
+}
+
+int lexLine(void) {
+    return tokenLine;
+}
+
+void setLexLine(int line) {
+    tokenLine = nextLine = line;
+}
+
+void lexStats(long long *nanos, long long *tokens) {
+    *nanos = lexNanos;
+    *tokens = lexTokens;
 }
 
 int match(TokenSet token) {
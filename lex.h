@@ -1,6 +1,8 @@
 #ifndef __LEX__
 #define __LEX__
 
+#include <stddef.h>
+
 #define MAXLEN 256
 
 // Token types
@@ -23,4 +25,25 @@ extern void advance(void);
 // Get the lexeme of the current token
 extern char *getLexeme(void);
 
+// Read the following tokens from buf instead of stdin
+extern void setLexBuffer(const char *buf, size_t len);
+
+// Test if the buffer given to setLexBuffer is used up
+extern int lexAtEnd(void);
+
+// Time in ns spent reading tokens while tracing, and tokens read by this thread
+extern void lexStats(long long *nanos, long long *tokens);
+
+// Tokens read by this thread, the current one included
+extern long long tokensRead(void);
+
+// When the current token was read, in the ns of latencyClock
+extern long long tokenClock(void);
+
+// Input line of the current token
+extern int lexLine(void);
+
+// Count the lines of the following tokens from line
+extern void setLexLine(int line);
+
 #endif // __LEX__
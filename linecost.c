@@ -0,0 +1,108 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "linecost.h"
+#include "sim.h"
+
+int lineReport = 0;
+
+// Work caused by one input line
+typedef struct {
+    int line;
+    long long tokens;
+    long long nodes;
+    long long instrs;
+    int regs;               // peak registers
+    long long cycles;
+} LineCost;
+
+static LineCost *lines = NULL;
+static int nlines = 0, cap = 0;
+static SimConfig cost;
+static int useCost = 0;
+
+static LineCost *getLine(int line) {
+    int old = cap;
+
+    if (line >= cap) {
+        while (line >= cap) cap = cap ? cap * 2 : 1024;
+        lines = (LineCost*)realloc(lines, sizeof(LineCost) * cap);
+        memset(lines + old, 0, sizeof(LineCost) * (cap - old));
+    }
+    if (line >= nlines) nlines = line + 1;
+    lines[line].line = line;
+    return &lines[line];
+}
+
+void countLine(Tree *t, long long tokens) {
+    LineCost *lc;
+
+    if (t == NULL || t->n == 0) return;
+    lc = getLine(t->line);
+    lc->tokens += tokens;
+    lc->nodes += t->n;
+}
+
+void countCode(int line, const Instr *ins, int n, int regs) {
+    LineCost *lc = getLine(line);
+
+    lc->instrs += n;
+    if (regs > lc->regs) lc->regs = regs;
+    if (useCost) lc->cycles += blockCycles(&cost, ins, n);
+}
+
+static long long weight(const LineCost *lc) {
+    return useCost ? lc->cycles : lc->instrs;
+}
+
+// Most expensive first, then in line order
+static int byCost(const void *a, const void *b) {
+    const LineCost *x = (const LineCost*)a, *y = (const LineCost*)b;
+
+    if (weight(x) != weight(y)) return weight(x) < weight(y) ? 1 : -1;
+    return x->line - y->line;
+}
+
+static void printLineReport(void) {
+    LineCost total;
+    int i, n = 0;
+
+    memset(&total, 0, sizeof(total));
+    for (i = 0; i < nlines; i++) {
+        if (lines[i].tokens == 0 && lines[i].instrs == 0) continue;
+        total.tokens += lines[i].tokens;
+        total.nodes += lines[i].nodes;
+        total.instrs += lines[i].instrs;
+        total.cycles += lines[i].cycles;
+        if (lines[i].regs > total.regs) total.regs = lines[i].regs;
+        lines[n++] = lines[i];
+    }
+    qsort(lines, n, sizeof(LineCost), byCost);
+
+    fprintf(stderr, "%8s %8s %8s %8s %5s", "line", "tokens", "nodes", "instrs", "regs");
+    if (useCost) fprintf(stderr, " %8s %6s", "cycles", "share");
+    fprintf(stderr, "\n");
+    for (i = 0; i < n && i < lineReport; i++) {
+        fprintf(stderr, "%8d %8lld %8lld %8lld %5d", lines[i].line, lines[i].tokens,
+            lines[i].nodes, lines[i].instrs, lines[i].regs);
+        if (useCost)
+            fprintf(stderr, " %8lld %5.1f%%", lines[i].cycles,
+                total.cycles ? lines[i].cycles * 100.0 / total.cycles : 0.0);
+        fprintf(stderr, "\n");
+    }
+    fprintf(stderr, "%8s %8lld %8lld %8lld %5d", "total", total.tokens, total.nodes,
+        total.instrs, total.regs);
+    if (useCost) fprintf(stderr, " %8lld", total.cycles);
+    fprintf(stderr, "\n");
+}
+
+int openLineReport(const char *costPath) {
+    initSimConfig(&cost);
+    if (costPath != NULL) {
+        if (!loadSimConfig(&cost, costPath)) return 0;
+        useCost = 1;
+    }
+    atexit(printLineReport);
+    return 1;
+}
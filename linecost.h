@@ -0,0 +1,22 @@
+#ifndef __LINECOST__
+#define __LINECOST__
+
+#include "parser.h"
+#include "isa.h"
+
+// Enabled with -fline-report[=N]: the N most expensive input lines are
+// printed to stderr at exit, 0 if disabled
+extern int lineReport;
+
+// Start the report; with costPath, a latency table in the format of
+// sim -c, the lines are ranked by simulated cycles instead of instructions.
+// Return 0 if the table cannot be read
+extern int openLineReport(const char *costPath);
+
+// Count the tokens and nodes of a parsed statement
+extern void countLine(Tree *t, long long tokens);
+
+// Count the code generated for the statement parsed on line
+extern void countCode(int line, const Instr *ins, int n, int regs);
+
+#endif // __LINECOST__
@@ -3,8 +3,31 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <unistd.h>
 #include "lex.h"
 #include "parser.h"
+#include "opt.h"
+#include "parallel.h"
+#include "cache.h"
+#include "promote.h"
+#include "codeGen.h"
+#include "isa.h"
+#include "trace.h"
+#include "stream.h"
+#include "push.h"
+#include "isel.h"
+#include "passes.h"
+#include "linecost.h"
+#include "sched.h"
+#include "slp.h"
+#include "incr.h"
+#include "rules.h"
+#include "layout.h"
+#include "latency.h"
+#include "aot.h"
+#include "snapshot.h"
+#include "memstat.h"
+#include "memo.h"
 
 // This package is a calculator
 // It works like a Python interpretor
@@ -29,10 +52,204 @@
 //		   	      LPAREN expr RPAREN |
 //		   	      ADDSUB LPAREN expr RPAREN
 
-int main() {
+// Usage: compiler [options] [file]
+// Options:
+// -fconst-prop  propagate known constants across statements and fold
+// -fsimplify    algebraic identities and known-bits simplification
+// -O0, -O1, -O2 no passes, const-prop and simplify, and also rle,
+//               copy-prop, dce and sched over the instructions; default -O0
+// -fpasses=LIST run the comma separated passes instead of an -O level
+// -fpass-report print the time and effect of every pass to stderr
+// -j[N]         compile on N threads, all cores if N is omitted
+// -fcache=FILE  reuse the code of statements compiled in earlier runs
+// -fcache-size=MB  bound of the cache file, default 64
+// -fincremental=FILE  recompile only the lines changed since the compile
+//               that saved FILE and the lines that depend on them
+// -fpromote[=N] keep the N most used variables in registers for the whole
+//               program, all registers but two if N is omitted
+// -ftarget=NAME generate code for the target NAME, mini or mini-ls
+// -fregs=N      registers of the target, default the count of the target
+// -fisel        use immediate and memory operands, INC and DEC
+// -frules=FILE  take the code of expressions from a superopt rule database
+// -fslp         pack groups of 4 independent statements of the same shape
+//               into vector instructions
+// -flayout[=N]  place the variables used together in the same lines of N
+//               words, default 16; N=4 packs them in vector-aligned groups
+// -flayout-map=FILE  write the old and new address of every variable
+// -fstream      generate code while parsing, without building trees
+// -fpush        feed stdin to the push API as it arrives, in a poll loop
+// -ftrace=FILE  write a trace-event JSON timeline of the compiler phases
+// -fline-report[=N]  print the N most expensive input lines, default 10
+// -fcost=FILE   sim latency table for sched and the line report
+// -flatency     print p50/p99/p99.9 latency of the statements by phase and
+//               size to stderr at exit and on SIGUSR1
+// -faot[=SYMBOL]  print x86-64 GNU assembler of a function SYMBOL, default
+//               mini_program, instead of the pseudo-assembly
+// -fsnapshot-save=FILE  save the symbol table, its facts and the code of
+//               the program to FILE, to start later compiles from
+// -fsnapshot=FILE  start from the state saved in FILE and print its code,
+//               as if its program came before the input
+// -fmem-report  print the allocations and bytes of the lexer, the trees,
+//               the symbol tables and the code, the most a statement used
+//               and the peak RSS to stderr at exit
+// -fmemo[=N]    reuse the code of a statement compiled before with the same
+//               addresses and facts of what it reads, in memory, at most N
+//               statements, default 65536
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL, *cachePath = NULL, *tracePath = NULL, *incrPath = NULL;
+    const char *passList = NULL, *costPath = NULL, *rulesPath = NULL, *targetName = NULL, *aot = NULL;
+    const char *snapshotPath = NULL, *snapshotOut = NULL;
+    int nthreads = 0, cacheSize = 64, push = 0, level = 0, regs = 0, latency = 0, memory = 0, memo = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-fconst-prop") == 0) optConstProp = 1;
+        else if (strcmp(argv[i], "-fsimplify") == 0) optSimplify = 1;
+        else if (strcmp(argv[i], "-O0") == 0 || strcmp(argv[i], "-O1") == 0 || strcmp(argv[i], "-O2") == 0)
+            level = argv[i][2] - '0';
+        else if (strncmp(argv[i], "-fpasses=", 9) == 0) passList = argv[i] + 9;
+        else if (strcmp(argv[i], "-fpass-report") == 0) passReport = 1;
+        else if (strncmp(argv[i], "-j", 2) == 0) {
+            nthreads = argv[i][2] ? atoi(argv[i] + 2) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+            if (nthreads < 1) nthreads = 1;
+        }
+        else if (strncmp(argv[i], "-fcache=", 8) == 0) cachePath = argv[i] + 8;
+        else if (strncmp(argv[i], "-fcache-size=", 13) == 0) cacheSize = atoi(argv[i] + 13);
+        else if (strncmp(argv[i], "-fincremental=", 14) == 0) incrPath = argv[i] + 14;
+        else if (strcmp(argv[i], "-fpromote") == 0) optPromote = -1;
+        else if (strncmp(argv[i], "-fpromote=", 10) == 0) optPromote = atoi(argv[i] + 10);
+        else if (strncmp(argv[i], "-ftarget=", 9) == 0) targetName = argv[i] + 9;
+        else if (strncmp(argv[i], "-fregs=", 7) == 0) regs = atoi(argv[i] + 7);
+        else if (strcmp(argv[i], "-fisel") == 0) optIsel = 1;
+        else if (strncmp(argv[i], "-frules=", 8) == 0) rulesPath = argv[i] + 8;
+        else if (strcmp(argv[i], "-fslp") == 0) optSlp = 1;
+        else if (strcmp(argv[i], "-flayout") == 0) optLayout = 16;
+        else if (strncmp(argv[i], "-flayout=", 9) == 0) optLayout = atoi(argv[i] + 9);
+        else if (strncmp(argv[i], "-flayout-map=", 13) == 0) layoutMap = argv[i] + 13;
+        else if (strcmp(argv[i], "-fstream") == 0) optStream = 1;
+        else if (strcmp(argv[i], "-fpush") == 0) push = 1;
+        else if (strncmp(argv[i], "-ftrace=", 8) == 0) tracePath = argv[i] + 8;
+        else if (strcmp(argv[i], "-fline-report") == 0) lineReport = 10;
+        else if (strncmp(argv[i], "-fline-report=", 14) == 0) lineReport = atoi(argv[i] + 14);
+        else if (strncmp(argv[i], "-fcost=", 7) == 0) costPath = argv[i] + 7;
+        else if (strcmp(argv[i], "-flatency") == 0) latency = 1;
+        else if (strcmp(argv[i], "-faot") == 0) aot = "mini_program";
+        else if (strncmp(argv[i], "-faot=", 6) == 0) aot = argv[i] + 6;
+        else if (strcmp(argv[i], "-fmem-report") == 0) memory = 1;
+        else if (strcmp(argv[i], "-fmemo") == 0) memo = 65536;
+        else if (strncmp(argv[i], "-fmemo=", 7) == 0) memo = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "-fsnapshot=", 11) == 0) snapshotPath = argv[i] + 11;
+        else if (strncmp(argv[i], "-fsnapshot-save=", 16) == 0) snapshotOut = argv[i] + 16;
+        else if (argv[i][0] != '-' && path == NULL) path = argv[i];
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (!setPipeline(level, passList)) {
+        fprintf(stderr, "unknown pass or too many passes in -fpasses=%s\n", passList);
+        return 2;
+    }
+    if (layoutMap != NULL && optLayout == 0) optLayout = 16;
+    if ((nthreads > 0) + (cachePath != NULL) + (incrPath != NULL) + (optPromote != 0) + push + optSlp +
+        (optLayout != 0) > 1) {
+        fprintf(stderr, "-j, -fcache, -fincremental, -fpromote, -fpush, -fslp and -flayout cannot be combined\n");
+        return 2;
+    }
+    if (optStream && (nthreads > 0 || cachePath != NULL || incrPath != NULL || optPromote != 0 || push || optSlp ||
+        optLayout != 0 || npasses > 0 || optIsel || rulesPath != NULL)) {
+        fprintf(stderr, "-fstream cannot be combined with passes, -fisel, -frules, -j, -fcache, -fincremental, -fpromote, -fpush, -fslp or -flayout\n");
+        return 2;
+    }
+    if (lineReport > 0 && (nthreads > 0 || cachePath != NULL || incrPath != NULL || push || optStream || optSlp)) {
+        fprintf(stderr, "-fline-report cannot be combined with -j, -fcache, -fincremental, -fpush, -fstream or -fslp\n");
+        return 2;
+    }
+    // only statements compiled one at a time as they are read have a latency
+    if (latency && (nthreads > 0 || cachePath != NULL || incrPath != NULL || optPromote != 0 || push || optSlp ||
+        optLayout != 0 || optStream)) {
+        fprintf(stderr, "-flatency cannot be combined with -j, -fcache, -fincremental, -fpromote, -fpush, -fslp, -flayout or -fstream\n");
+        return 2;
+    }
+    // a snapshot is the state of a program compiled one statement at a time
+    if ((snapshotPath != NULL || snapshotOut != NULL) && (nthreads > 0 || cachePath != NULL ||
+        incrPath != NULL || optPromote != 0 || push || optSlp || optLayout != 0)) {
+        fprintf(stderr, "-fsnapshot and -fsnapshot-save cannot be combined with -j, -fcache, -fincremental, -fpromote, -fpush, -fslp or -flayout\n");
+        return 2;
+    }
+    // the memo replays whole statements compiled one at a time
+    if (memo != 0 && (optPromote != 0 || optSlp || optLayout != 0 || optStream || lineReport > 0)) {
+        fprintf(stderr, "-fmemo cannot be combined with -fpromote, -fslp, -flayout, -fstream or -fline-report\n");
+        return 2;
+    }
+    if (memo < 0) {
+        fprintf(stderr, "-fmemo must be positive\n");
+        return 2;
+    }
+    // saved code does not record which latencies it was scheduled for
+    if (costPath != NULL && (cachePath != NULL || incrPath != NULL)) {
+        fprintf(stderr, "-fcost cannot be combined with -fcache or -fincremental\n");
+        return 2;
+    }
+    // a line holds whole vectors and the table holds whole lines
+    if (optLayout != 0 && (optLayout < VLANES || optLayout > TBLSIZE || TBLSIZE % optLayout != 0)) {
+        fprintf(stderr, "-flayout must be a multiple of %d that divides %d\n", VLANES, TBLSIZE);
+        return 2;
+    }
+    if (targetName != NULL && (backend = findTarget(targetName)) == NULL) {
+        fprintf(stderr, "unknown target %s\n", targetName);
+        return 2;
+    }
+    if (optSlp && !hasForm(FORM_VECTOR)) {
+        fprintf(stderr, "-fslp needs a target with the vector extension\n");
+        return 2;
+    }
+    targetRegs = regs != 0 ? regs : backend->regs;
+    if (targetRegs < 3 || targetRegs > MAXREGS) {
+        fprintf(stderr, "-fregs must be between 3 and %d\n", MAXREGS);
+        return 2;
+    }
+    // vars is an array of int32
+    if (aot != NULL && backend->wordSize != 4) {
+        fprintf(stderr, "-faot needs a target with 4-byte words\n");
+        return 2;
+    }
+    if (aot != NULL && (aot[0] == '\0' || isdigit((unsigned char)aot[0]) ||
+        strspn(aot, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_") != strlen(aot))) {
+        fprintf(stderr, "-faot=%s is not a C identifier\n", aot);
+        return 2;
+    }
+    if (tracePath != NULL) openTrace(tracePath);
+    if (!loadScheduleCost(costPath)) return 2;
+    if (rulesPath != NULL && !loadRules(rulesPath)) return 2;
+    if (lineReport > 0 && !openLineReport(costPath)) return 2;
+    if (latency) openLatency();
+    if (memory) openMemReport();
+    if (memo > 0) openMemo(memo);
+    if (aot != NULL && !openAot(aot)) return 2;
+    if (snapshotOut != NULL) openSnapshotSave(snapshotOut);
     initTable();
+    if (snapshotPath != NULL && !loadSnapshot(snapshotPath)) return 2;
+    if (nthreads > 0) compileParallel(path, nthreads);
+    if (path != NULL && freopen(path, "r", stdin) == NULL) {
+        perror(path);
+        return 2;
+    }
+    if (cachePath != NULL) {
+        openCache(cachePath, cacheSize);
+        compileCached();
+    }
+    if (incrPath != NULL) {
+        openIncremental(incrPath);
+        compileIncremental();
+    }
+    if (optPromote != 0) compilePromoted();
+    if (optSlp) compileVectorized();
+    if (optLayout) compileLaidOut();
+    if (push) compilePushed();
     while (1) {
-        statement();
+        if (optStream) streamStatement();
+        else statement();
     }
     return 0;
 }
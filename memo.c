@@ -0,0 +1,297 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "memo.h"
+#include "codeGen.h"
+#include "passes.h"
+#include "opt.h"
+#include "trace.h"
+#include "memstat.h"
+
+#define NSHARDS 16      // each with its own lock and LRU order
+
+// A symbol table change replayed on a hit
+typedef struct {
+    int32_t idx;
+    int32_t known;
+    int32_t val;
+} Store;
+
+typedef struct {
+    uint64_t key[2];
+    int prev, next;     // neighbours in the LRU order, -1 at the ends
+    int chain;          // next entry of the bucket, -1 for none
+    int nstore;
+    int ndefine;        // the first ndefine stores define new variables
+    size_t len;         // bytes of the names of those and the text
+    size_t cap;
+    char *data;         // the stores, the names NUL terminated, the text
+} Entry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    Entry *entry;
+    int *bucket;        // first entry of every bucket, -1 for none
+    int nbucket;        // a power of two
+    int used;
+    int cap;
+    int head, tail;     // most and least recently used
+    long long hits, misses, evictions;
+} Shard;
+
+int optMemo = 0;
+
+static Shard shards[NSHARDS];
+
+static void printMemoStats(void) {
+    long long hits = 0, misses = 0, evictions = 0;
+    int used = 0;
+
+    for (int s = 0; s < NSHARDS; s++) {
+        hits += shards[s].hits;
+        misses += shards[s].misses;
+        evictions += shards[s].evictions;
+        used += shards[s].used;
+    }
+    fprintf(stderr, "memo: %lld hits, %lld misses, %lld evictions, %d of %d entries\n",
+        hits, misses, evictions, used, optMemo);
+}
+
+void openMemo(int entries) {
+    int per = (entries + NSHARDS - 1) / NSHARDS;
+
+    optMemo = per * NSHARDS;
+    for (int s = 0; s < NSHARDS; s++) {
+        Shard *sh = &shards[s];
+        pthread_mutex_init(&sh->lock, NULL);
+        sh->cap = per;
+        for (sh->nbucket = 1; sh->nbucket < per; sh->nbucket *= 2);
+        sh->entry = (Entry*)memRealloc(MEM_MEMO, NULL, 0, sizeof(Entry) * per);
+        sh->bucket = (int*)memRealloc(MEM_MEMO, NULL, 0, sizeof(int) * sh->nbucket);
+        memset(sh->entry, 0, sizeof(Entry) * per);
+        memset(sh->bucket, -1, sizeof(int) * sh->nbucket);
+        sh->head = sh->tail = -1;
+    }
+    atexit(printMemoStats);
+}
+
+static uint64_t splitmix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static void hashWord(uint64_t key[2], uint64_t w) {
+    key[0] = splitmix(key[0] ^ w);
+    key[1] = splitmix(key[1] + w * 0xff51afd7ed558ccdull);
+}
+
+// Key: the tree, which is the statement without its blanks and
+// redundant parentheses, the address of every variable it names and the
+// fact of every variable it reads
+static void makeKey(Tree *t, int passes, uint64_t key[2]) {
+    const BTNode *node;
+    const char *p;
+    size_t n;
+    uint64_t w;
+    int i, idx, undefined = 0;
+
+    key[0] = 0x6d656d6f6b657930ull ^ (uint64_t)passes;
+    key[1] = 0x6d656d6f6b657931ull;
+    hashWord(key, (uint64_t)t->n);
+    for (i = 0; i < t->n; i++) {
+        node = &t->node[i];
+        hashWord(key, (uint64_t)node->data | (uint64_t)node->op << 8 | (uint64_t)(uint32_t)node->left << 16 |
+            (uint64_t)(uint32_t)node->right << 40);
+        for (p = nodeLexeme(t, i);; p += 8) {
+            n = strnlen(p, 8);
+            w = 0;
+            memcpy(&w, p, n);
+            hashWord(key, w);
+            if (n < 8) break;
+        }
+        if (node->data != ID) continue;
+        idx = getvariable(nodeLexeme(t, i));
+        hashWord(key, (uint64_t)(int64_t)idx);
+        if (idx == -1) undefined = 1;
+        else if (passes && optConstProp && !(node->flags & NODE_ASSIGNED))
+            hashWord(key, table[idx].known ? 1ull << 32 | (uint32_t)table[idx].val : 0);
+    }
+    // new variables get the next free addresses
+    if (undefined) hashWord(key, (uint64_t)sbcount);
+}
+
+static Shard *shardOf(const uint64_t key[2]) {
+    return &shards[key[1] % NSHARDS];
+}
+
+static int findEntry(Shard *sh, const uint64_t key[2]) {
+    int e = sh->bucket[key[0] & (sh->nbucket - 1)];
+    while (e != -1 && (sh->entry[e].key[0] != key[0] || sh->entry[e].key[1] != key[1]))
+        e = sh->entry[e].chain;
+    return e;
+}
+
+static void detach(Shard *sh, int e) {
+    Entry *en = &sh->entry[e];
+    if (en->prev != -1) sh->entry[en->prev].next = en->next;
+    else sh->head = en->next;
+    if (en->next != -1) sh->entry[en->next].prev = en->prev;
+    else sh->tail = en->prev;
+}
+
+static void pushFront(Shard *sh, int e) {
+    sh->entry[e].prev = -1;
+    sh->entry[e].next = sh->head;
+    if (sh->head != -1) sh->entry[sh->head].prev = e;
+    sh->head = e;
+    if (sh->tail == -1) sh->tail = e;
+}
+
+// Copy the stores, and the names and the text of the entry of key to
+// out; return 0 if there is none
+static int lookup(const uint64_t key[2], Store *store, int *nstore, int *ndefine, OutBuf *out) {
+    Shard *sh = shardOf(key);
+    Entry *en;
+    int e;
+
+    pthread_mutex_lock(&sh->lock);
+    if ((e = findEntry(sh, key)) == -1) {
+        sh->misses++;
+        pthread_mutex_unlock(&sh->lock);
+        return 0;
+    }
+    sh->hits++;
+    en = &sh->entry[e];
+    *nstore = en->nstore;
+    *ndefine = en->ndefine;
+    memcpy(store, en->data, sizeof(Store) * en->nstore);
+    if (en->len > out->cap) {
+        out->data = (char*)memRealloc(MEM_CODE, out->data, out->cap, en->len);
+        out->cap = en->len;
+    }
+    memcpy(out->data, en->data + sizeof(Store) * en->nstore, en->len);
+    out->len = en->len;
+    detach(sh, e);
+    pushFront(sh, e);
+    pthread_mutex_unlock(&sh->lock);
+    return 1;
+}
+
+// Remember a compiled statement, evicting the least recently used one
+static void insert(const uint64_t key[2], const Store *store, int nstore, int ndefine, const OutBuf *names,
+    const OutBuf *text) {
+    Shard *sh = shardOf(key);
+    size_t len = names->len + text->len, size = sizeof(Store) * nstore + len;
+    Entry *en;
+    int e, *link;
+
+    pthread_mutex_lock(&sh->lock);
+    if (findEntry(sh, key) != -1) {
+        // another thread compiled the same statement meanwhile
+        pthread_mutex_unlock(&sh->lock);
+        return;
+    }
+    if (sh->used < sh->cap) {
+        e = sh->used++;
+    } else {
+        e = sh->tail;
+        detach(sh, e);
+        for (link = &sh->bucket[sh->entry[e].key[0] & (sh->nbucket - 1)]; *link != e; link = &sh->entry[*link].chain);
+        *link = sh->entry[e].chain;
+        sh->evictions++;
+    }
+    en = &sh->entry[e];
+    if (size > en->cap) {
+        en->data = (char*)memRealloc(MEM_MEMO, en->data, en->cap, size);
+        en->cap = size;
+    }
+    memcpy(en->data, store, sizeof(Store) * nstore);
+    memcpy(en->data + sizeof(Store) * nstore, names->data, names->len);
+    memcpy(en->data + sizeof(Store) * nstore + names->len, text->data, text->len);
+    en->key[0] = key[0];
+    en->key[1] = key[1];
+    en->nstore = nstore;
+    en->ndefine = ndefine;
+    en->len = len;
+    en->chain = sh->bucket[key[0] & (sh->nbucket - 1)];
+    sh->bucket[key[0] & (sh->nbucket - 1)] = e;
+    pushFront(sh, e);
+    pthread_mutex_unlock(&sh->lock);
+}
+
+// The variables the statement defined, in address order, with their
+// names, then the facts of the ones it assigns
+static int collectStores(Tree *t, int first, Store *store, int *ndefine, OutBuf *names) {
+    int i, k, idx, n = 0;
+
+    names->len = 0;
+    for (idx = first; idx < sbcount; idx++) {
+        emitTo(names, "%s%c", table[idx].name, '\0');
+        store[n++].idx = idx;
+    }
+    *ndefine = n;
+    for (i = 0; i < t->n; i++) {
+        if (t->node[i].data != ID || !(t->node[i].flags & NODE_TARGET)) continue;
+        idx = getvariable(nodeLexeme(t, i));
+        for (k = 0; k < n && store[k].idx != idx; k++);
+        if (k == n) store[n++].idx = idx;
+    }
+    for (k = 0; k < n; k++) {
+        store[k].known = table[store[k].idx].known;
+        store[k].val = table[store[k].idx].val;
+    }
+    return n;
+}
+
+void memoStatement(Tree *t, int passes) {
+    static _Thread_local OutBuf text, names;
+    static _Thread_local Store store[TBLSIZE];
+    jmp_buf jb, *outer = errorJump;
+    OutBuf *saved = getOutput();
+    uint64_t key[2];
+    char *p;
+    int k, nstore, ndefine, first = sbcount;
+    long long start = traceClock();
+
+    makeKey(t, passes, key);
+    if (lookup(key, store, &nstore, &ndefine, &text)) {
+        p = text.data;
+        for (k = 0; k < ndefine; k++) {
+            setvariable(p);
+            p += strlen(p) + 1;
+        }
+        for (k = 0; k < nstore; k++) {
+            table[store[k].idx].known = store[k].known;
+            table[store[k].idx].val = store[k].val;
+        }
+        emit("%.*s", (int)(text.data + text.len - p), p);
+        traceSpan("memo hit", start, "bytes", (long long)(text.data + text.len - p));
+        return;
+    }
+
+    text.len = 0;
+    setOutput(&text);
+    errorJump = &jb;
+    if (setjmp(jb) != 0) {
+        // the output up to the error and its EXIT 1 go out, nothing is kept
+        setOutput(saved);
+        errorJump = outer;
+        if (text.len > 0) emit("%.*s", (int)text.len, text.data);
+        if (outer != NULL) longjmp(*outer, 1);
+        exit(0);
+    }
+    if (passes) runTreePasses(t);
+    compileStatement(t);
+    setOutput(saved);
+    errorJump = outer;
+    emit("%.*s", (int)text.len, text.data);
+    nstore = ndefine = names.len = 0;
+    if (passes) nstore = collectStores(t, first, store, &ndefine, &names);
+    insert(key, store, nstore, ndefine, &names, &text);
+    traceSpan("memo miss", start, NULL, 0);
+}
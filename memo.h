@@ -0,0 +1,19 @@
+#ifndef __MEMO__
+#define __MEMO__
+
+#include "parser.h"
+
+// Entries of the statement memo, set with -fmemo[=N]; 0 when it is off
+extern int optMemo;
+
+// Create the memo with entries entries and print its counters at exit
+extern void openMemo(int entries);
+
+// Compile a parsed statement, or replay it if the same statement was
+// compiled before with the same addresses and, with const-prop, the same
+// facts for the variables it reads: print its prefix and code and make
+// its stores. With passes 0 the tree passes have already run and only
+// the code is memoized. Safe to call from several threads.
+extern void memoStatement(Tree *t, int passes);
+
+#endif // __MEMO__
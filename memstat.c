@@ -0,0 +1,113 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include "memstat.h"
+#include "parser.h"
+
+static const char *areaName[MEMAREAS] = { "lexer", "ast", "symbols", "code", "memo" };
+static const char *phaseName[MEMPHASES] = { "parse", "passes", "codegen" };
+
+// Memory of an area that is not on the heap: the lexeme of the lexer of
+// a thread and the symbol table of the program
+static const size_t staticBytes[MEMAREAS] = { MAXLEN, 0, sizeof(Symbol) * TBLSIZE, 0, 0 };
+
+int memReport = 0;
+
+// Shared by the threads of -j, updated with atomics
+static long long allocs[MEMAREAS], bytes[MEMAREAS], live[MEMAREAS], peak[MEMAREAS];
+static long long liveTotal = 0, peakTotal = 0;
+static long long phasePeak[MEMPHASES], statements = 0, worst = -1;
+static int worstLine = 0;
+static pthread_mutex_t worstLock = PTHREAD_MUTEX_INITIALIZER;
+
+// The statement of this thread: its phase, -1 outside one, the bytes in
+// use when it started, the most in use since the phase started and since
+// the statement started
+static _Thread_local int phase = -1;
+static _Thread_local long long base, high, top;
+
+static void atLeast(long long *max, long long v) {
+    long long old = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (v > old && !__atomic_compare_exchange_n(max, &old, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static void count(MemArea area, long long delta, size_t size) {
+    long long now;
+
+    if (size > 0) {
+        __atomic_add_fetch(&allocs[area], 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&bytes[area], (long long)size, __ATOMIC_RELAXED);
+    }
+    atLeast(&peak[area], __atomic_add_fetch(&live[area], delta, __ATOMIC_RELAXED));
+    now = __atomic_add_fetch(&liveTotal, delta, __ATOMIC_RELAXED);
+    atLeast(&peakTotal, now);
+    if (phase >= 0 && now > high) high = now;
+}
+
+static void printMemReport(void) {
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    fprintf(stderr, "memory: peak RSS %ld KB, heap peak %lld bytes, %lld statements\n",
+        ru.ru_maxrss, peakTotal, statements);
+    fprintf(stderr, "  area         allocs        bytes         live         peak       static\n");
+    for (int a = 0; a < MEMAREAS; a++)
+        fprintf(stderr, "  %-8s %10lld %12lld %12lld %12lld %12zu\n",
+            areaName[a], allocs[a], bytes[a], live[a], peak[a], staticBytes[a]);
+    if (statements == 0) return;
+    fprintf(stderr, "  peak over the start of a statement, by phase:");
+    for (int p = 0; p < MEMPHASES; p++)
+        fprintf(stderr, " %s %lld", phaseName[p], phasePeak[p]);
+    fprintf(stderr, " bytes\n");
+    fprintf(stderr, "  largest statement: %lld bytes at line %d\n", worst, worstLine);
+}
+
+void openMemReport(void) {
+    memReport = 1;
+    atexit(printMemReport);
+}
+
+void *memRealloc(MemArea area, void *p, size_t old, size_t size) {
+    void *q = realloc(p, size);
+
+    if (memReport && q != NULL) count(area, (long long)size - (long long)old, size);
+    return q;
+}
+
+void memFree(MemArea area, void *p, size_t size) {
+    free(p);
+    if (memReport && p != NULL) count(area, -(long long)size, 0);
+}
+
+// Close the phase the statement is in
+static void endPhase(void) {
+    atLeast(&phasePeak[phase], high - base);
+    if (high > top) top = high;
+}
+
+void memPhase(MemPhase next) {
+    if (!memReport) return;
+    if (next == MEMPHASE_PARSE) {
+        base = top = __atomic_load_n(&liveTotal, __ATOMIC_RELAXED);
+    } else if (phase >= 0) {
+        endPhase();
+    }
+    high = __atomic_load_n(&liveTotal, __ATOMIC_RELAXED);
+    phase = next;
+}
+
+void memEndStatement(int line) {
+    if (!memReport || phase < 0) return;
+    endPhase();
+    phase = -1;
+    __atomic_add_fetch(&statements, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&worstLock);
+    if (top - base > worst) {
+        worst = top - base;
+        worstLine = line;
+    }
+    pthread_mutex_unlock(&worstLock);
+}
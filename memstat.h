@@ -0,0 +1,45 @@
+#ifndef __MEMSTAT__
+#define __MEMSTAT__
+
+#include <stddef.h>
+
+// Enabled with -fmem-report: the heap memory of the compiler counted by
+// the subsystem that owns it, printed to stderr at exit
+extern int memReport;
+
+// Owner of an allocation
+typedef enum {
+    MEM_LEX,        // input lines held for the lexer
+    MEM_AST,        // trees: nodes, lexemes and walk scratch
+    MEM_SYMBOLS,    // symbol tables of the push API
+    MEM_CODE,       // printed code and the instruction buffers of the passes
+    MEM_MEMO,       // entries of the statement memo
+    MEMAREAS
+} MemArea;
+
+// Phases of a statement, as the ones of -flatency
+typedef enum {
+    MEMPHASE_PARSE,
+    MEMPHASE_PASSES,
+    MEMPHASE_CODEGEN,
+    MEMPHASES
+} MemPhase;
+
+// Install the exit handler
+extern void openMemReport(void);
+
+// realloc counted for area; old is the size p had. Allocations are
+// counted only with -fmem-report, the call is a realloc without it
+extern void *memRealloc(MemArea area, void *p, size_t old, size_t size);
+
+// free counted for area; size is the size p had
+extern void memFree(MemArea area, void *p, size_t size);
+
+// The statement compiled on this thread enters phase; MEMPHASE_PARSE
+// starts it, and what it uses is measured from there
+extern void memPhase(MemPhase phase);
+
+// The statement of input line line is compiled
+extern void memEndStatement(int line);
+
+#endif // __MEMSTAT__
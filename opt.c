@@ -0,0 +1,330 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "opt.h"
+
+int optConstProp = 0;
+int optSimplify = 0;
+
+// What the current walk does: substitute known variables, apply the
+// identities, keep the constant facts of the symbol table up to date
+static int substituting, simplifying, recording;
+
+// Bits of a value that are provably 0 or 1
+typedef struct {
+    unsigned int zeros;
+    unsigned int ones;
+} KnownBits;
+
+static const KnownBits unknownBits = { 0, 0 };
+
+// Value of an INT node, wrapped to 32 bits like the target
+int intValue(Tree *t, int i) {
+    return (int)(unsigned int)strtoll(nodeLexeme(t, i), NULL, 10);
+}
+
+static KnownBits constBits(int val) {
+    KnownBits kb;
+    kb.ones = (unsigned int)val;
+    kb.zeros = ~(unsigned int)val;
+    return kb;
+}
+
+static int allKnown(KnownBits kb) {
+    return (kb.zeros | kb.ones) == ~0u;
+}
+
+// Mark the nodes from first to last dropped
+static void drop(Tree *t, int first, int last) {
+    for (int j = first; j <= last; j++)
+        t->node[j].flags |= NODE_DEAD;
+}
+
+// Turn node i into an INT leaf holding val
+static KnownBits setConstant(Tree *t, int i, int val) {
+    char buf[16];
+
+    drop(t, firstNode(t, i), i - 1);
+    sprintf(buf, "%d", val);
+    t->node[i].data = INT;
+    t->node[i].op = OP_MOV;
+    t->node[i].val = 0;
+    t->node[i].left = t->node[i].right = -1;
+    t->node[i].lexeme = addText(t, buf);
+    return constBits(val);
+}
+
+// Replace node i by its child keep, dropping the other child; i keeps
+// its place under its parent
+static KnownBits keepChild(Tree *t, int i, int keep, KnownBits kb) {
+    BTNode *node = &t->node[i], *k = &t->node[keep];
+    int other = keep == node->left ? node->right : node->left;
+
+    drop(t, firstNode(t, other), other);
+    node->data = k->data;
+    node->op = k->op;
+    node->val = k->val;
+    node->left = k->left;
+    node->right = k->right;
+    node->lexeme = k->lexeme;
+    k->flags |= NODE_DEAD;
+    return kb;
+}
+
+// Compute l op r with 32-bit wraparound, return 0 if it would trap
+int applyOp(Opcode op, int l, int r, int *res) {
+    unsigned int a = (unsigned int)l, b = (unsigned int)r;
+
+    switch (op) {
+    case OP_ADD: *res = (int)(a + b); break;
+    case OP_SUB: *res = (int)(a - b); break;
+    case OP_MUL: *res = (int)(a * b); break;
+    case OP_DIV:
+        if (r == 0 || (l == (int)0x80000000 && r == -1)) return 0;
+        *res = l / r;
+        break;
+    case OP_OR: *res = l | r; break;
+    case OP_AND: *res = l & r; break;
+    case OP_XOR: *res = l ^ r; break;
+    default: return 0;
+    }
+    return 1;
+}
+
+// A subtree can be dropped if evaluating it has no side effect and
+// cannot fail on an undefined variable
+int droppable(Tree *t, int i) {
+    for (int j = firstNode(t, i); j <= i; j++) {
+        if (t->node[j].flags & NODE_DEAD) continue;
+        switch (t->node[j].data) {
+        case ID:
+            if (getvariable(nodeLexeme(t, j)) == -1) return 0;
+            break;
+        case ASSIGN:
+        case ADDSUB_ASSIGN:
+        case UNARY:
+            return 0;
+        default:
+            break;
+        }
+    }
+    return 1;
+}
+
+// The live nodes of both subtrees in postfix order; the shape follows
+// from the kinds, so equal sequences are equal trees
+int sameTree(Tree *t, int a, int b) {
+    int i = firstNode(t, a), j = firstNode(t, b);
+
+    while (1) {
+        while (i <= a && (t->node[i].flags & NODE_DEAD)) i++;
+        while (j <= b && (t->node[j].flags & NODE_DEAD)) j++;
+        if (i > a || j > b) return i > a && j > b;
+        if (t->node[i].data != t->node[j].data || strcmp(nodeLexeme(t, i), nodeLexeme(t, j)) != 0) return 0;
+        i++;
+        j++;
+    }
+}
+
+// Known bits of a + b + carry, after LLVM's computeForAddCarry
+static KnownBits addBits(KnownBits a, KnownBits b, int carryZero, int carryOne) {
+    KnownBits kb;
+    unsigned int sumZero = ~a.zeros + ~b.zeros + (carryZero ? 0u : 1u);
+    unsigned int sumOne = a.ones + b.ones + (carryOne ? 1u : 0u);
+    unsigned int carryKnownZero = ~(sumZero ^ a.zeros ^ b.zeros);
+    unsigned int carryKnownOne = sumOne ^ a.ones ^ b.ones;
+    unsigned int known = (a.zeros | a.ones) & (b.zeros | b.ones) & (carryKnownZero | carryKnownOne);
+
+    kb.zeros = ~sumZero & known;
+    kb.ones = sumOne & known;
+    return kb;
+}
+
+static int trailingZeros(KnownBits kb) {
+    int n = 0;
+    while (n < 32 && (kb.zeros >> n & 1u)) n++;
+    return n;
+}
+
+// Known bits of the result of a binary operator
+static KnownBits combineBits(char op, KnownBits l, KnownBits r) {
+    KnownBits kb = unknownBits, nr;
+    int tz;
+
+    switch (op) {
+    case '&':
+        kb.ones = l.ones & r.ones;
+        kb.zeros = l.zeros | r.zeros;
+        break;
+    case '|':
+        kb.ones = l.ones | r.ones;
+        kb.zeros = l.zeros & r.zeros;
+        break;
+    case '^':
+        kb.ones = (l.ones & r.zeros) | (l.zeros & r.ones);
+        kb.zeros = (l.zeros & r.zeros) | (l.ones & r.ones);
+        break;
+    case '+':
+        kb = addBits(l, r, 1, 0);
+        break;
+    case '-':
+        // a - b = a + ~b + 1
+        nr.zeros = r.ones;
+        nr.ones = r.zeros;
+        kb = addBits(l, nr, 0, 1);
+        break;
+    case '*':
+        tz = trailingZeros(l) + trailingZeros(r);
+        kb.zeros = tz >= 32 ? ~0u : (1u << tz) - 1;
+        break;
+    default:
+        break;
+    }
+    return kb;
+}
+
+// Apply identities to binary node i whose operands have bits l and r
+static KnownBits simplifyNode(Tree *t, int i, KnownBits l, KnownBits r) {
+    int a = t->node[i].left, b = t->node[i].right;
+    char op = nodeLexeme(t, i)[0];
+    KnownBits kb = combineBits(op, l, r);
+    int same = droppable(t, a) && droppable(t, b) && sameTree(t, a, b);
+
+    if (allKnown(kb) && droppable(t, i)) return setConstant(t, i, (int)kb.ones);
+
+    switch (op) {
+    case '+':
+        if (r.zeros == ~0u && droppable(t, b)) return keepChild(t, i, a, l);    // x + 0
+        if (l.zeros == ~0u && droppable(t, a)) return keepChild(t, i, b, r);    // 0 + x
+        break;
+    case '-':
+        if (r.zeros == ~0u && droppable(t, b)) return keepChild(t, i, a, l);    // x - 0
+        if (same) return setConstant(t, i, 0);                                  // x - x
+        break;
+    case '*':
+        if (r.ones == 1u && r.zeros == ~1u && droppable(t, b)) return keepChild(t, i, a, l);
+        if (l.ones == 1u && l.zeros == ~1u && droppable(t, a)) return keepChild(t, i, b, r);
+        break;
+    case '/':
+        if (r.ones == 1u && r.zeros == ~1u && droppable(t, b)) return keepChild(t, i, a, l);
+        // 0 / x, the trap of x == 0 is not preserved
+        if (l.zeros == ~0u && droppable(t, i)) return setConstant(t, i, 0);
+        break;
+    case '&':
+        if (same) return keepChild(t, i, a, l);                                  // x & x
+        // a mask that clears only bits already known to be zero
+        if ((l.zeros | r.ones) == ~0u && droppable(t, b)) return keepChild(t, i, a, l);
+        if ((r.zeros | l.ones) == ~0u && droppable(t, a)) return keepChild(t, i, b, r);
+        break;
+    case '|':
+        if (same) return keepChild(t, i, a, l);                                  // x | x
+        // or-ing in only bits already known to be one
+        if ((l.ones | r.zeros) == ~0u && droppable(t, b)) return keepChild(t, i, a, l);
+        if ((r.ones | l.zeros) == ~0u && droppable(t, a)) return keepChild(t, i, b, r);
+        break;
+    case '^':
+        if (same) return setConstant(t, i, 0);                                  // x ^ x
+        if (r.zeros == ~0u && droppable(t, b)) return keepChild(t, i, a, l);    // x ^ 0
+        if (l.zeros == ~0u && droppable(t, a)) return keepChild(t, i, b, r);    // 0 ^ x
+        break;
+    }
+    return kb;
+}
+
+// Walk in postfix order, the order evaluateTree emits code in, so that
+// assignments inside an expression are seen before the reads that follow
+// them. A rewrite only drops nodes before the one being visited; they
+// are removed at the end.
+static void optimize(Tree *t) {
+    KnownBits *bits = (KnownBits*)treeScratch(t, sizeof(KnownBits));
+    int i, idx, val;
+
+    for (i = 0; i < t->n; i++) {
+        BTNode *node = &t->node[i];
+        switch (node->data) {
+        case INT:
+            bits[i] = constBits(intValue(t, i));
+            break;
+
+        case ID:
+            // an undefined variable stays in the tree for the code to fail
+            // on, after the side effects that come before it
+            bits[i] = unknownBits;
+            if (node->flags & NODE_TARGET) {
+                if (!recording) break;
+                idx = getvariable(nodeLexeme(t, i));
+                if (idx != -1 || (node->flags & NODE_UPDATED)) break;
+                setvariable(nodeLexeme(t, i));
+                break;
+            }
+            if (!substituting) break;
+            idx = getvariable(nodeLexeme(t, i));
+            if (idx == -1) break;
+            if (table[idx].known) bits[i] = setConstant(t, i, table[idx].val);
+            break;
+
+        case ASSIGN:
+            bits[i] = bits[node->right];
+            if (!recording) break;
+            idx = getvariable(nodeLexeme(t, node->left));
+            table[idx].known = t->node[node->right].data == INT;
+            if (table[idx].known) table[idx].val = intValue(t, node->right);
+            break;
+
+        case ADDSUB_ASSIGN:
+        case UNARY:
+            bits[i] = unknownBits;
+            if (!recording) break;
+            idx = getvariable(nodeLexeme(t, node->left));
+            if (idx == -1) break;
+            if (substituting && table[idx].known && t->node[node->right].data == INT &&
+                applyOp((Opcode)node->op, table[idx].val, intValue(t, node->right), &val)) {
+                // x += c with x known becomes a plain store of the new value
+                node->data = ASSIGN;
+                node->op = OP_MOV;
+                node->lexeme = addText(t, "=");
+                t->node[node->left].flags = (t->node[node->left].flags & ~NODE_UPDATED) | NODE_ASSIGNED;
+                table[idx].val = val;
+                bits[i] = setConstant(t, node->right, val);
+                break;
+            }
+            table[idx].known = 0;
+            break;
+
+        case OR:
+        case XOR:
+        case AND:
+        case ADDSUB:
+        case MULDIV:
+            if (t->node[node->left].data == INT && t->node[node->right].data == INT &&
+                applyOp((Opcode)node->op, intValue(t, node->left), intValue(t, node->right), &val))
+                bits[i] = setConstant(t, i, val);
+            else if (simplifying)
+                bits[i] = simplifyNode(t, i, bits[node->left], bits[node->right]);
+            else
+                bits[i] = combineBits(nodeLexeme(t, i)[0], bits[node->left], bits[node->right]);
+            break;
+
+        default:
+            bits[i] = unknownBits;
+            break;
+        }
+    }
+    compactTree(t);
+}
+
+void constPropTree(Tree *t) {
+    substituting = recording = 1;
+    simplifying = 0;
+    optimize(t);
+}
+
+// Writes facts but never reads them, so after const-prop each variable
+// ends with the fact of the last store to it, now perhaps a constant
+void simplifyTree(Tree *t, int facts) {
+    substituting = 0;
+    recording = facts;
+    simplifying = 1;
+    optimize(t);
+}
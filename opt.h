@@ -0,0 +1,33 @@
+#ifndef __OPT__
+#define __OPT__
+
+#include "parser.h"
+
+// Enabled with -fconst-prop: substitute variables holding known constants
+// and fold constant subtrees; the facts are kept in the symbol table
+extern int optConstProp;
+
+// Enabled with -fsimplify: algebraic identities and known-bits folding
+extern int optSimplify;
+
+// Substitute and fold the known constants of one statement
+extern void constPropTree(Tree *t);
+
+// Simplify one statement; with facts set it also records the constants
+// the statement stores, which it may only do once constPropTree has run
+// over the same statement
+extern void simplifyTree(Tree *t, int facts);
+
+// Value of an INT node, wrapped to 32 bits like the target
+extern int intValue(Tree *t, int i);
+
+// Compute l op r with 32-bit wraparound, return 0 if it would trap
+extern int applyOp(Opcode op, int l, int r, int *res);
+
+// Subtree i has no side effect and reads no undefined variable
+extern int droppable(Tree *t, int i);
+
+// Subtrees a and b are the same expression
+extern int sameTree(Tree *t, int a, int b);
+
+#endif // __OPT__
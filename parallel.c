@@ -0,0 +1,267 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "parallel.h"
+#include "codeGen.h"
+#include "passes.h"
+#include "trace.h"
+#include "memstat.h"
+#include "memo.h"
+
+#ifndef CHUNKSIZE
+#define CHUNKSIZE (64 * 1024)   // bytes of input per chunk
+#endif
+#define BATCH 4                 // chunks per thread kept in memory at once
+
+// What is printed after the compiled statements of a chunk
+typedef enum {
+    TAIL_NONE, TAIL_ERROR, TAIL_END
+} TailType;
+
+typedef struct {
+    const char *begin;
+    const char *end;
+    int last;           // last chunk of the input
+    int line;           // input line the chunk starts at
+    Tree **trees;       // kept from batch to batch and cleared for reuse
+    int ntrees;
+    int cap;
+    TailType stop;      // how parsing stopped: end of chunk, error or ENDFILE
+    int ncompile;       // statements left to compile after resolution
+    TailType tail;
+    OutBuf out;
+} Chunk;
+
+typedef struct {
+    Chunk *chunks;
+    int n;
+    void (*work)(Chunk *c);
+    atomic_int next;
+    atomic_int threads;     // trace id of the next worker thread
+} Job;
+
+static void runJob(Job *job) {
+    int i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->n)
+        job->work(&job->chunks[i]);
+}
+
+static void *worker(void *arg) {
+    Job *job = (Job*)arg;
+    traceSetThread(atomic_fetch_add(&job->threads, 1));
+    runJob(job);
+    return NULL;
+}
+
+// Run work on every chunk, the calling thread helps
+static void runParallel(Chunk *chunks, int n, void (*work)(Chunk *c), int nthreads) {
+    pthread_t *tid = (pthread_t*)malloc(sizeof(pthread_t) * nthreads);
+    Job job;
+    int i;
+
+    job.chunks = chunks;
+    job.n = n;
+    job.work = work;
+    atomic_init(&job.next, 0);
+    atomic_init(&job.threads, 2);
+    for (i = 1; i < nthreads && i < n; i++)
+        pthread_create(&tid[i], NULL, worker, &job);
+    runJob(&job);
+    for (i = 1; i < nthreads && i < n; i++)
+        pthread_join(tid[i], NULL);
+    free(tid);
+}
+
+// statement := ENDFILE | END | expr END, for every statement of a chunk
+static void parseChunk(Chunk *c) {
+    jmp_buf jb;
+    OutBuf scratch = { NULL, 0, 0 };
+    long long start = traceClock();
+
+    setLexBuffer(c->begin, c->end - c->begin);
+    setLexLine(c->line);
+    setOutput(&scratch);
+    errorJump = &jb;
+    c->stop = TAIL_NONE;
+    if (setjmp(jb) == 0) {
+        while (1) {
+            if (match(ENDFILE)) {
+                // a chunk boundary, unless the input really ends here
+                if (c->last || !lexAtEnd()) c->stop = TAIL_END;
+                break;
+            } else if (match(END)) {
+                advance();
+            } else {
+                if (c->ntrees == c->cap) {
+                    c->cap = c->cap ? c->cap * 2 : 256;
+                    c->trees = (Tree**)realloc(c->trees, sizeof(Tree*) * c->cap);
+                    memset(c->trees + c->ntrees, 0, sizeof(Tree*) * (c->cap - c->ntrees));
+                }
+                if (c->trees[c->ntrees] == NULL) c->trees[c->ntrees] = newTree();
+                clearTree(c->trees[c->ntrees]);
+                assign_expr(c->trees[c->ntrees]);
+                if (!match(END)) error(SYNTAXERR);
+                c->ntrees++;
+                advance();
+            }
+        }
+    } else {
+        c->stop = TAIL_ERROR;
+    }
+    errorJump = NULL;
+    setOutput(NULL);
+    freeOutput(&scratch);
+    traceLex(start);
+    traceSpan("parseChunk", start, "statements", c->ntrees);
+}
+
+// Optimize and resolve the statements of a chunk in order,
+// return 1 if the program ends in this chunk
+static int resolveChunk(Chunk *c) {
+    jmp_buf jb;
+    OutBuf scratch = { NULL, 0, 0 };
+    int i;
+    volatile int finished = c->stop != TAIL_NONE;
+    long long start = traceClock();
+
+    c->ncompile = c->ntrees;
+    c->tail = c->stop;
+    setOutput(&scratch);
+    errorJump = &jb;
+    for (i = 0; i < c->ntrees; i++) {
+        if (setjmp(jb) != 0) {
+            // the optimizer found an error, nothing of this statement is printed
+            c->ncompile = i;
+            c->tail = TAIL_ERROR;
+            finished = 1;
+            break;
+        }
+        runTreePasses(c->trees[i]);
+        if (!resolveSymbols(c->trees[i])) {
+            c->ncompile = i + 1;
+            c->tail = TAIL_NONE;
+            finished = 1;
+            break;
+        }
+    }
+    errorJump = NULL;
+    setOutput(NULL);
+    freeOutput(&scratch);
+    traceSpan("resolveChunk", start, "statements", c->ntrees);
+    return finished;
+}
+
+static void compileChunk(Chunk *c) {
+    jmp_buf jb;
+    int i;
+    long long start = traceClock();
+
+    setOutput(&c->out);
+    errorJump = &jb;
+    if (setjmp(jb) == 0) {
+        for (i = 0; i < c->ncompile; i++) {
+            resetRegister();
+            if (optMemo) memoStatement(c->trees[i], 0);
+            else compileStatement(c->trees[i]);
+        }
+        if (c->tail == TAIL_ERROR) emit("%s 1\n", backend->mnemonic[OP_EXIT]);
+        else if (c->tail == TAIL_END) endProgram();
+    } else {
+        // the code ran out of registers, the program stops in this chunk
+        c->tail = TAIL_ERROR;
+    }
+    errorJump = NULL;
+    setOutput(NULL);
+    traceSpan("compileChunk", start, "statements", c->ncompile);
+}
+
+// Map the input file, or read all of stdin
+static const char *loadInput(const char *path, size_t *size) {
+    struct stat st;
+    char *data = NULL;
+    size_t cap = 0, n;
+    int fd;
+
+    if (path != NULL) {
+        if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+            perror(path);
+            exit(2);
+        }
+        *size = (size_t)st.st_size;
+        if (*size == 0) return "";
+        data = (char*)mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == (char*)MAP_FAILED) {
+            perror(path);
+            exit(2);
+        }
+        return data;
+    }
+    *size = 0;
+    do {
+        if (*size == cap) {
+            data = (char*)memRealloc(MEM_LEX, data, cap, cap ? cap * 2 : 1 << 20);
+            cap = cap ? cap * 2 : 1 << 20;
+        }
+        n = fread(data + *size, 1, cap - *size, stdin);
+        *size += n;
+    } while (n > 0);
+    return data;
+}
+
+void compileParallel(const char *path, int nthreads) {
+    size_t size;
+    const char *data = loadInput(path, &size);
+    const char *p = data, *end = data + size, *nl;
+    int nchunks = nthreads * BATCH, n, i, finished = 0, line = 1;
+    Chunk *chunks = (Chunk*)calloc(nchunks, sizeof(Chunk));
+    long long start;
+
+    for (i = 2; i <= nthreads; i++)
+        traceThreadName(i, "worker");
+    while (!finished) {
+        // split the next part of the input at newlines
+        for (n = 0; n < nchunks && (n == 0 || !chunks[n - 1].last); n++) {
+            chunks[n].begin = p;
+            nl = end - p > CHUNKSIZE ? (const char*)memchr(p + CHUNKSIZE, '\n', end - p - CHUNKSIZE) : NULL;
+            chunks[n].end = nl != NULL ? nl + 1 : end;
+            chunks[n].last = chunks[n].end == end;
+            chunks[n].line = line;
+            for (nl = p; (nl = (const char*)memchr(nl, '\n', chunks[n].end - nl)) != NULL; nl++)
+                line++;
+            chunks[n].ntrees = 0;
+            chunks[n].out.len = 0;
+            p = chunks[n].end;
+        }
+
+        start = traceClock();
+        runParallel(chunks, n, parseChunk, nthreads);
+        traceSpan("parse", start, "chunks", n);
+        start = traceClock();
+        for (i = 0; i < n; i++) {
+            if (finished) {
+                chunks[i].ncompile = 0;
+                chunks[i].tail = TAIL_NONE;
+            }
+            else finished = resolveChunk(&chunks[i]);
+        }
+        traceSpan("resolve", start, "chunks", n);
+        start = traceClock();
+        runParallel(chunks, n, compileChunk, nthreads);
+        traceSpan("compile", start, "chunks", n);
+
+        start = traceClock();
+        for (i = 0; i < n && (i == 0 || chunks[i - 1].tail != TAIL_ERROR); i++)
+            fwrite(chunks[i].out.data, 1, chunks[i].out.len, stdout);
+        if (i < n) finished = 1;
+        traceSpan("output", start, "chunks", n);
+    }
+    exit(0);
+}
@@ -0,0 +1,11 @@
+#ifndef __PARALLEL__
+#define __PARALLEL__
+
+// Compile the input file (stdin if path is NULL) on nthreads threads.
+// The input is split at newlines into chunks that are lexed and parsed
+// in parallel, symbols are resolved in statement order, then the code of
+// the chunks is generated in parallel and printed in order, byte-identical
+// to the serial path. Exits like statement does at the end of the input.
+extern void compileParallel(const char *path, int nthreads);
+
+#endif // __PARALLEL__
@@ -4,17 +4,31 @@
 #include <string.h>
 #include "parser.h"
 #include "codeGen.h"
+#include "trace.h"
+#include "passes.h"
+#include "linecost.h"
+#include "latency.h"
+#include "snapshot.h"
+#include "memstat.h"
+#include "memo.h"
 
 int sbcount = 0;
-Symbol table[TBLSIZE];
+static Symbol symbols[TBLSIZE];
+Symbol *table = symbols;
 
 void initTable(void) {
     strcpy(table[0].name, "x");
     table[0].val = 0;
+    table[0].known = 1;
+    table[0].reg = -1;
     strcpy(table[1].name, "y");
     table[1].val = 0;
+    table[1].known = 1;
+    table[1].reg = -1;
     strcpy(table[2].name, "z");
     table[2].val = 0;
+    table[2].known = 1;
+    table[2].reg = -1;
     sbcount = 3;
 }
 
@@ -27,65 +41,226 @@ int getvariable(char* str) {
 
 int setvariable(char* str) {
     strcpy(table[sbcount].name, str);
+    table[sbcount].val = 0;
+    table[sbcount].known = 0;
+    table[sbcount].reg = -1;
     return sbcount++;
 }
 
-BTNode *makeNode(TokenSet tok, const char *lexe) {
-    BTNode *node = (BTNode*)malloc(sizeof(BTNode));
-    strcpy(node->lexeme, lexe);
-    node->data = tok;
-    node->val = 0;
-    node->left = NULL;
-    node->right = NULL;
-    return node;
+Tree *newTree(void) {
+    Tree *t = (Tree*)memRealloc(MEM_AST, NULL, 0, sizeof(Tree));
+    memset(t, 0, sizeof(Tree));
+    return t;
 }
 
-void freeTree(BTNode *root) {
-    if (root != NULL) {
-        freeTree(root->left);
-        freeTree(root->right);
-        free(root);
-    }
+void clearTree(Tree *t) {
+    t->n = 0;
+    t->len = 0;
 }
 
-int existvariable(BTNode* node) {
-    if (node) {
-		if (node->data == ID) return 1;
-		return existvariable(node->left) || existvariable(node->right);
+void freeTree(Tree *t) {
+    if (t != NULL) {
+        memFree(MEM_AST, t->node, sizeof(BTNode) * t->cap);
+        memFree(MEM_AST, t->text, t->textCap);
+        memFree(MEM_AST, t->scratch, t->scratchCap);
+        memFree(MEM_AST, t, sizeof(Tree));
     }
-	return 0;
 }
 
-int evalValue(BTNode* root) {
-    int lval, rval;
-    switch (root->data) {
-    case INT:
-        return atoi(root->lexeme);
+int addText(Tree *t, const char *lexe) {
+    int n = (int)strlen(lexe) + 1, at = t->len, cap;
+
+    if (t->len + n > t->textCap) {
+        cap = (t->textCap + n) * 2;
+        t->text = (char*)memRealloc(MEM_AST, t->text, t->textCap, cap);
+        t->textCap = cap;
+    }
+    memcpy(t->text + at, lexe, n);
+    t->len += n;
+    return at;
+}
 
+Opcode opcodeOf(TokenSet tok, const char *lexe) {
+    switch (tok) {
+    case ADDSUB:
+    case ADDSUB_ASSIGN:
+    case UNARY:
+        return lexe[0] == '+' ? OP_ADD : OP_SUB;
+    case MULDIV:
+        return lexe[0] == '*' ? OP_MUL : OP_DIV;
+    case AND:
+        return OP_AND;
     case OR:
+        return OP_OR;
     case XOR:
-    case AND:
+        return OP_XOR;
+    default:
+        return OP_MOV;
+    }
+}
+
+int makeNode(Tree *t, TokenSet tok, const char *lexe, int left, int right) {
+    BTNode *node;
+    int cap;
+
+    if (t->n == t->cap) {
+        cap = t->cap ? t->cap * 2 : 16;
+        t->node = (BTNode*)memRealloc(MEM_AST, t->node, sizeof(BTNode) * t->cap, sizeof(BTNode) * cap);
+        t->cap = cap;
+    }
+    if (t->n == 0) t->line = lexLine();
+    node = &t->node[t->n];
+    node->data = (uint8_t)tok;
+    node->flags = 0;
+    node->op = (uint8_t)opcodeOf(tok, lexe);
+    node->val = 0;
+    node->left = left;
+    node->right = right;
+    node->lexeme = addText(t, lexe);
+    switch (tok) {
+    case ASSIGN:
+        t->node[left].flags |= NODE_ASSIGNED;
+        break;
+    case ADDSUB_ASSIGN:
+    case UNARY:
+        t->node[left].flags |= NODE_UPDATED;
+        break;
     case ADDSUB:
     case MULDIV:
-        lval = evalValue(root->left);
-        rval = evalValue(root->right);
-
-        if (strcmp(root->lexeme, "+") == 0) return lval + rval;
-        else if (strcmp(root->lexeme, "-") == 0) return lval - rval;
-        else if (strcmp(root->lexeme, "*") == 0) return lval * rval;
-        else if (strcmp(root->lexeme, "/") == 0) {
-            if (rval == 0) error(DIVZERO);
-            return lval / rval;
-        }
-        else if (strcmp(root->lexeme, "|") == 0) return lval | rval;
-        else if (strcmp(root->lexeme, "&") == 0) return lval & rval;
-        else if (strcmp(root->lexeme, "^") == 0) return lval ^ rval;
+    case AND:
+    case OR:
+    case XOR:
+        t->node[right].flags |= NODE_OPERAND;
         break;
-
     default:
-		error(NOTNUMID);
         break;
     }
+    return t->n++;
+}
+
+int firstNode(const Tree *t, int i) {
+    while (t->node[i].left >= 0) i = t->node[i].left;
+    return i;
+}
+
+void *treeScratch(Tree *t, size_t size) {
+    if (size * t->n > t->scratchCap) {
+        memFree(MEM_AST, t->scratch, t->scratchCap);
+        t->scratchCap = size * t->cap;
+        t->scratch = memRealloc(MEM_AST, NULL, 0, t->scratchCap);
+    }
+    return t->scratch;
+}
+
+void compactTree(Tree *t) {
+    int *to = (int*)treeScratch(t, sizeof(int));
+    int i, n = 0;
+
+    for (i = 0; i < t->n; i++) {
+        if (t->node[i].flags & NODE_DEAD) continue;
+        to[i] = n;
+        t->node[n] = t->node[i];
+        if (t->node[n].left >= 0) t->node[n].left = to[t->node[n].left];
+        if (t->node[n].right >= 0) t->node[n].right = to[t->node[n].right];
+        n++;
+    }
+    t->n = n;
+}
+
+// Every node gets its position from its parent, which comes after it:
+// the left child right behind the parent, the right one behind the
+// whole left subtree
+int prefixOrder(Tree *t, int i, int **order) {
+    int first = firstNode(t, i), size = i - first + 1, j, l, r;
+    int *pos = (int*)treeScratch(t, 3 * sizeof(int)), *len = pos + t->n;
+
+    *order = len + t->n;
+    pos[i] = 0;
+    len[i] = size;
+    for (j = i; j >= first; j--) {
+        (*order)[pos[j]] = j;
+        if ((l = t->node[j].left) < 0) continue;
+        r = t->node[j].right;
+        len[r] = r - l;
+        len[l] = len[j] - 1 - len[r];
+        pos[l] = pos[j] + 1;
+        pos[r] = pos[j] + 1 + len[l];
+    }
+    return size;
+}
+
+int writeTree(FILE *fp, const Tree *t) {
+    int head[3] = { t->n, t->len, t->line };
+
+    return fwrite(head, sizeof(head), 1, fp) == 1 &&
+        fwrite(t->node, sizeof(BTNode), t->n, fp) == (size_t)t->n &&
+        fwrite(t->text, 1, t->len, fp) == (size_t)t->len;
+}
+
+int readTree(FILE *fp, Tree *t) {
+    int head[3];
+
+    if (fread(head, sizeof(head), 1, fp) != 1 || head[0] < 0 || head[1] < 0) return 0;
+    if (head[0] > t->cap) {
+        t->node = (BTNode*)memRealloc(MEM_AST, t->node, sizeof(BTNode) * t->cap, sizeof(BTNode) * head[0]);
+        t->cap = head[0];
+    }
+    if (head[1] > t->textCap) {
+        t->text = (char*)memRealloc(MEM_AST, t->text, t->textCap, head[1]);
+        t->textCap = head[1];
+    }
+    t->n = head[0];
+    t->len = head[1];
+    t->line = head[2];
+    return fread(t->node, sizeof(BTNode), t->n, fp) == (size_t)t->n &&
+        fread(t->text, 1, t->len, fp) == (size_t)t->len;
+}
+
+static int existvariable(Tree *t, int i) {
+    for (int j = firstNode(t, i); j <= i; j++)
+        if (t->node[j].data == ID) return 1;
+    return 0;
+}
+
+// Value of a subtree of constants, evaluated on a stack in postfix order
+static int evalValue(Tree *t, int i) {
+    int *stack = (int*)treeScratch(t, sizeof(int));
+    int top = 0, lval, rval, j;
+
+    for (j = firstNode(t, i); j <= i; j++) {
+        switch (t->node[j].data) {
+        case INT:
+            stack[top++] = atoi(nodeLexeme(t, j));
+            break;
+
+        case OR:
+        case XOR:
+        case AND:
+        case ADDSUB:
+        case MULDIV:
+            rval = stack[--top];
+            lval = stack[--top];
+            switch (t->node[j].op) {
+            case OP_ADD: lval = lval + rval; break;
+            case OP_SUB: lval = lval - rval; break;
+            case OP_MUL: lval = lval * rval; break;
+            case OP_DIV:
+                if (rval == 0) error(DIVZERO);
+                lval = lval / rval;
+                break;
+            case OP_OR: lval = lval | rval; break;
+            case OP_AND: lval = lval & rval; break;
+            default: lval = lval ^ rval; break;
+            }
+            stack[top++] = lval;
+            break;
+
+        default:
+            error(NOTNUMID);
+            break;
+        }
+    }
+    return stack[0];
 }
 
 // factor := INT | ADDSUB INT |
@@ -93,30 +268,30 @@ int evalValue(BTNode* root) {
 //		   	 ID ASSIGN expr |
 //		   	 LPAREN expr RPAREN |
 //		   	 ADDSUB LPAREN expr RPAREN
-BTNode *factor(void) {
-    BTNode *retp = NULL, *left = NULL;
+int factor(Tree *t) {
+    int retp = -1, left, right = -1;
+    char op[MAXLEN];
 
     if (match(INT)) {
-        retp = makeNode(INT, getLexeme());
+        retp = makeNode(t, INT, getLexeme(), -1, -1);
         advance();
     } else if (match(ID)) {
-        left = makeNode(ID, getLexeme());
+        retp = makeNode(t, ID, getLexeme(), -1, -1);
         advance();
-        retp = left;
     } 
     else if (match(ADDSUB)) {
-        retp = makeNode(ADDSUB, getLexeme());
-        retp->left = makeNode(INT, "0");
+        strcpy(op, getLexeme());
+        left = makeNode(t, INT, "0", -1, -1);
         advance();
         if (match(INT)) {
-            retp->right = makeNode(INT, getLexeme());
+            right = makeNode(t, INT, getLexeme(), -1, -1);
             advance();
         } else if (match(ID)) {
-            retp->right = makeNode(ID, getLexeme());
+            right = makeNode(t, ID, getLexeme(), -1, -1);
             advance();
         } else if (match(LPAREN)) {
             advance();
-			retp->right = assign_expr();
+			right = assign_expr(t);
             if (match(RPAREN))
                 advance();
             else
@@ -124,9 +299,10 @@ BTNode *factor(void) {
         } else {
             error(NOTNUMID);
         }
+        retp = makeNode(t, ADDSUB, op, left, right);
     } else if (match(LPAREN)) {
         advance();
-        retp = assign_expr();
+        retp = assign_expr(t);
         if (match(RPAREN))
             advance();
         else
@@ -137,51 +313,53 @@ BTNode *factor(void) {
     return retp;
 }
 
-BTNode* unary() {
+int unary(Tree *t) {
+    char op[MAXLEN];
+    int left;
+
     if (match(UNARY)) {
-        BTNode* node = makeNode(UNARY, getLexeme());
+        strcpy(op, getLexeme());
         advance();
         if (match(ID)) {
-            node->left = unary();
-            node->right = makeNode(INT, "1");
-            return node;
+            left = unary(t);
+            return makeNode(t, UNARY, op, left, makeNode(t, INT, "1", -1, -1));
         }
         else error(NOTNUMID);
-    } else return factor();
+    } else return factor(t);
 }
 
 // term := factor term_tail
-BTNode *term(void) {
-    BTNode *node = unary();
-    return term_tail(node);
+int term(Tree *t) {
+    int node = unary(t);
+    return term_tail(t, node);
 }
 
 // term_tail := MULDIV factor term_tail | NiL
-BTNode* term_tail(BTNode* left) {
-    BTNode* node = NULL;
+int term_tail(Tree *t, int left) {
+    char op[MAXLEN];
+    int right;
 
     if (match(MULDIV)) {
-        node = makeNode(MULDIV, getLexeme());
+        strcpy(op, getLexeme());
         advance();
-        node->left = left;
-        node->right = unary();
-        if (!existvariable(node->right) && evalValue(node->right) == 0) 
+        right = unary(t);
+        if (!existvariable(t, right) && evalValue(t, right) == 0) 
 			error(DIVZERO);
-        return term_tail(node);
+        return term_tail(t, makeNode(t, MULDIV, op, left, right));
     }
     else return left;
 }
 
 // expr_tail := ADDSUB term expr_tail | NiL
-BTNode* expr_tail(BTNode* left) {
-    BTNode* node = NULL;
+int expr_tail(Tree *t, int left) {
+    char op[MAXLEN];
+    int right;
 
     if (match(ADDSUB)) {
-        node = makeNode(ADDSUB, getLexeme());
+        strcpy(op, getLexeme());
         advance();
-        node->left = left;
-        node->right = term();
-        return expr_tail(node);
+        right = term(t);
+        return expr_tail(t, makeNode(t, ADDSUB, op, left, right));
     }
     else {
         return left;
@@ -189,110 +367,189 @@ BTNode* expr_tail(BTNode* left) {
 }
 
 // expr := term expr_tail
-BTNode* expr(void) {
-    BTNode* node = term();
-    return expr_tail(node);
+int expr(Tree *t) {
+    int node = term(t);
+    return expr_tail(t, node);
 }
 
-BTNode* andexpr_tail(BTNode* left) {
-    BTNode* node = NULL;
+int andexpr_tail(Tree *t, int left) {
+    char op[MAXLEN];
+    int right;
 
     if (match(AND)) {
-        node = makeNode(AND, getLexeme());
+        strcpy(op, getLexeme());
         advance();
-        node->left = left;
-        node->right = expr();
-        return andexpr_tail(node);
+        right = expr(t);
+        return andexpr_tail(t, makeNode(t, AND, op, left, right));
     }
     else {
         return left;
     }
 }
 
-BTNode* andexpr(void) {
-    BTNode* node = expr();
-    return andexpr_tail(node);
+int andexpr(Tree *t) {
+    int node = expr(t);
+    return andexpr_tail(t, node);
 }
 
-BTNode* xorexpr_tail(BTNode* left) {
-    BTNode* node = NULL;
+int xorexpr_tail(Tree *t, int left) {
+    char op[MAXLEN];
+    int right;
 
     if (match(XOR)) {
-        node = makeNode(XOR, getLexeme());
+        strcpy(op, getLexeme());
         advance();
-        node->left = left;
-		node->right = andexpr();
-        return xorexpr_tail(node);
+		right = andexpr(t);
+        return xorexpr_tail(t, makeNode(t, XOR, op, left, right));
     }
     else {
         return left;
     }
 }
 
-BTNode* xorexpr(void) {
-	BTNode* node = andexpr();
-    return xorexpr_tail(node);
+int xorexpr(Tree *t) {
+	int node = andexpr(t);
+    return xorexpr_tail(t, node);
 }
 
-BTNode* orexpr_tail(BTNode* left) {
-    BTNode* node = NULL;
+int orexpr_tail(Tree *t, int left) {
+    char op[MAXLEN];
+    int right;
 
     if (match(OR)) {
-        node = makeNode(OR, getLexeme());
+        strcpy(op, getLexeme());
         advance();
-        node->left = left;
-		node->right = xorexpr();
-        return orexpr_tail(node);
+		right = xorexpr(t);
+        return orexpr_tail(t, makeNode(t, OR, op, left, right));
     }
     else {
         return left;
     }
 }
 
-BTNode* orexpr(void) {
-	BTNode* node = xorexpr();
-    return orexpr_tail(node);
+int orexpr(Tree *t) {
+	int node = xorexpr(t);
+    return orexpr_tail(t, node);
 }
 
-BTNode* assign_expr() {
-	BTNode* retp = NULL, *left=orexpr();//assume not =
-    if (left->data == ID && (match(ASSIGN) || match(ADDSUB_ASSIGN))) {
-        retp = makeNode(match(ASSIGN) ? ASSIGN : ADDSUB_ASSIGN, getLexeme());
+int assign_expr(Tree *t) {
+	int left = orexpr(t), right;//assume not =
+    TokenSet tok;
+    char op[MAXLEN];
+
+    if (t->node[left].data == ID && (match(ASSIGN) || match(ADDSUB_ASSIGN))) {
+        tok = match(ASSIGN) ? ASSIGN : ADDSUB_ASSIGN;
+        strcpy(op, getLexeme());
         advance();
-        retp->left = left;
-        retp->right = assign_expr();
-	} else retp = left;
-	return retp;
+        right = assign_expr(t);
+        return makeNode(t, tok, op, left, right);
+	}
+	return left;
+}
+
+// In the order evaluateTree reads and defines the variables
+int resolveSymbols(Tree *t) {
+    for (int i = 0; i < t->n; i++) {
+        BTNode *node = &t->node[i];
+        if (node->data != ID) continue;
+        if (getvariable(nodeLexeme(t, i)) != -1) continue;
+        if (!(node->flags & NODE_ASSIGNED)) return 0;
+        setvariable(nodeLexeme(t, i));
+    }
+    return 1;
+}
+
+// Print the code that ends the program
+void endProgram(void) {
+    if (snapshotSave != NULL) saveSnapshot();
+    for (int i = 0;i < 3;i++) {
+        emit("%s r%d [%d]\n", backend->mnemonic[OP_MOV], i, varAddress(i));
+    }
+    emit("%s 0\n", backend->mnemonic[OP_EXIT]);
+}
+
+// Print the prefix form and the code of a statement
+void compileStatement(Tree *t) {
+    printPrefix(t);
+    emit("\n");
+    generateCode(t);
 }
 
 // statement := ENDFILE | END | expr END
 void statement(void) {
-    BTNode *retp = NULL, *variable=NULL;
+    static long long count = 0;
+    static _Thread_local Tree *retp = NULL;
+    long long start, t, first, stamp[LATPHASES];
 
     if (match(ENDFILE)) {
-        for (int i = 0;i < 3;i++) {
-            printf("MOV r%d [%d]\n", i, 4 * i);
-        }
-		printf("EXIT 0\n");
+        endProgram();
         exit(0);
     } else if (match(END)) {
         advance();
     } else {
-        retp = assign_expr();
+        start = traceClock();
+        first = tokensRead();
+        stamp[LAT_TOTAL] = tokenClock();
+        memPhase(MEMPHASE_PARSE);
+        if (retp == NULL) retp = newTree();
+        clearTree(retp);
+        assign_expr(retp);
+        traceLex(start);
+        traceSpan("assign_expr", start, NULL, 0);
         freeRegister();
 
         if (match(END)) {
-            printPrefix(retp);
-            printf("\n");
-            evaluateTree(retp);
-            freeTree(retp);
+            if (lineReport) countLine(retp, tokensRead() - first + 1);
+            stamp[LAT_PARSE] = latencyClock();
+            memPhase(MEMPHASE_PASSES);
+            // the memo runs the passes with the code, or skips both
+            if (!optMemo) runTreePasses(retp);
+            stamp[LAT_PASSES] = latencyClock();
+            memPhase(MEMPHASE_CODEGEN);
+            if (optMemo) memoStatement(retp, 1);
+            else if (tracing) {
+                // the same as compileStatement, one span per step
+                t = traceClock();
+                printPrefix(retp);
+                emit("\n");
+                traceSpan("printPrefix", t, NULL, 0);
+                t = traceClock();
+                generateCode(retp);
+                traceSpan("generateCode", t, NULL, 0);
+                t = traceClock();
+                fflush(stdout);
+                traceSpan("output", t, NULL, 0);
+            }
+            else compileStatement(retp);
+            if (latencyReport) {
+                // the output of the statement is written before the next is read
+                stamp[LAT_CODEGEN] = latencyClock();
+                fflush(stdout);
+                stamp[LAT_OUTPUT] = latencyClock();
+                recordLatency(stamp, tokensRead() - first + 1);
+            }
+            memEndStatement(retp->line);
+            traceSpan("statement", start, "n", ++count);
             advance();
         }
         else error(SYNTAXERR);
     }
 }
 
+// Compile the statements of one input line held in memory
+void compileLine(const char *line, size_t len) {
+    setLexBuffer(line, len);
+    while (!match(ENDFILE) || !lexAtEnd()) {
+        statement();
+    }
+}
+
+_Thread_local jmp_buf *errorJump = NULL;
+
 void err(ErrorType errorNum) {
-	printf("EXIT 1\n");
+    // the statement that failed is counted up to where it failed
+    memEndStatement(lexLine());
+    emit("%s 1\n", backend->mnemonic[OP_EXIT]);
+    if (errorJump != NULL) longjmp(*errorJump, 1);
     exit(0);
 }
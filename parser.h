@@ -1,7 +1,11 @@
 #ifndef __PARSER__
 #define __PARSER__
 
+#include <stdio.h>
+#include <stdint.h>
+#include <setjmp.h>
 #include "lex.h"
+#include "isa.h"
 #define TBLSIZE 64
 
 // Call this macro to print error message and exit the program
@@ -19,20 +23,54 @@ typedef enum {
 // Structure of the symbol table
 typedef struct {
     int val;
+    int known;  // val is a known constant at this point of the program
+    int reg;    // register holding the variable, -1 if it lives in memory
     char name[MAXLEN];
 } Symbol;
 
-// Structure of a tree node
-typedef struct _Node {
-    TokenSet data;
-    int val;
-    char lexeme[MAXLEN];
-    struct _Node *left; 
-    struct _Node *right;
+// Structure of a tree node. The nodes of a statement sit in one array in
+// postfix order, children before their parent and the root last, and
+// refer to each other by index, so a walk is a loop over the array
+typedef struct {
+    uint8_t data;       // TokenSet
+    uint8_t flags;      // NODE_*
+    uint8_t op;         // Opcode of an operator, set from the lexeme
+    uint8_t val;        // scratch of a walk, the tile chosen by isel
+    int32_t left;       // children, -1 for none
+    int32_t right;
+    int32_t lexeme;     // offset of the lexeme in the text of the tree
 } BTNode;
 
-// The symbol table
-extern Symbol table[TBLSIZE];
+// Where a node sits under its parent
+#define NODE_ASSIGNED 1 // the variable a = assigns, defined if new
+#define NODE_UPDATED 2  // the variable += -= ++ -- update, must exist
+#define NODE_OPERAND 4  // the right operand of a binary operator
+#define NODE_DEAD 8     // dropped by a rewrite, gone after compactTree
+#define NODE_SKIP 16    // consumed by its parent, set by selectTree
+
+#define NODE_TARGET (NODE_ASSIGNED | NODE_UPDATED)
+
+// The tree of a statement. It holds no pointers into itself, so the
+// nodes and the text can be written out and read back as they are.
+typedef struct {
+    BTNode *node;
+    int n;
+    int cap;
+    char *text;         // the lexemes, NUL terminated
+    int len;
+    int textCap;
+    int line;           // input line of the statement
+    void *scratch;      // per-node working memory of a walk
+    size_t scratchCap;
+} Tree;
+
+#define nodeLexeme(t, i) ((t)->text + (t)->node[i].lexeme)
+
+// The symbol table, TBLSIZE entries; every stream of the push API has its own
+extern Symbol *table;
+
+// Number of variables in the symbol table
+extern int sbcount;
 
 // Initialize the symbol table with builtin variables
 extern void initTable(void);
@@ -43,25 +81,66 @@ extern int getval(char *str);
 // Set the value of a variable
 extern int setval(char *str, int val);
 
-// Make a new node according to token type and lexeme
-extern BTNode *makeNode(TokenSet tok, const char *lexe);
+// Allocate an empty tree, empty it for the next statement, free it
+extern Tree *newTree(void);
+extern void clearTree(Tree *t);
+extern void freeTree(Tree *t);
+
+// Opcode of an operator token, OP_MOV for the other tokens
+extern Opcode opcodeOf(TokenSet tok, const char *lexe);
+
+// Append a node with its children; return its index
+extern int makeNode(Tree *t, TokenSet tok, const char *lexe, int left, int right);
 
-// Free the syntax tree
-extern void freeTree(BTNode *root);
+// Copy a lexeme into the text of the tree; return its offset
+extern int addText(Tree *t, const char *lexe);
 
-extern BTNode *factor(void);
-extern BTNode *term(void);
-extern BTNode *term_tail(BTNode *left);
-extern BTNode *expr(void);
-extern BTNode *expr_tail(BTNode *left);
+// First node of the subtree rooted at i; the subtree spans first .. i
+extern int firstNode(const Tree *t, int i);
+
+// Working memory of size bytes for every node of the tree
+extern void *treeScratch(Tree *t, size_t size);
+
+// Remove the nodes marked NODE_DEAD, renumbering the others
+extern void compactTree(Tree *t);
+
+// The nodes of the subtree rooted at i in prefix order; return their number
+extern int prefixOrder(Tree *t, int i, int **order);
+
+// Write the tree as it is in memory, read one back; return 0 on error
+extern int writeTree(FILE *fp, const Tree *t);
+extern int readTree(FILE *fp, Tree *t);
+
+// The grammar; every rule appends its nodes to t and returns its root
+extern int factor(Tree *t);
+extern int term(Tree *t);
+extern int term_tail(Tree *t, int left);
+extern int expr(Tree *t);
+extern int expr_tail(Tree *t, int left);
 extern void statement(void);
 
-extern BTNode* assign_expr(void);
-extern BTNode* orexpr(void);
+// Assign addresses in the order evaluateTree does; return 0 if an
+// undefined variable is read and code generation of the statement will fail
+extern int resolveSymbols(Tree *t);
+
+// Print the code that ends the program
+extern void endProgram(void);
+
+// Print the prefix form and the code of a statement
+extern void compileStatement(Tree *t);
+
+// Compile the statements of one input line held in memory
+extern void compileLine(const char *line, size_t len);
+
+extern int assign_expr(Tree *t);
+extern int orexpr(Tree *t);
 
 // Print error message and exit the program
 extern void err(ErrorType errorNum);
 
+// When set, err jumps here instead of exiting
+extern _Thread_local jmp_buf *errorJump;
+
 extern int getvariable(char* str);
 extern int setvariable(char* str);
 
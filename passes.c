@@ -0,0 +1,478 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "passes.h"
+#include "opt.h"
+#include "isel.h"
+#include "isa.h"
+#include "codeGen.h"
+#include "trace.h"
+#include "linecost.h"
+#include "sched.h"
+#include "rules.h"
+#include "rewrite.h"
+#include "memstat.h"
+
+int npasses = 0;
+int passReport = 0;
+
+// A pass rewrites either the tree of a statement or its instructions
+typedef enum {
+    PASS_TREE, PASS_CODE
+} PassKind;
+
+typedef struct {
+    const char *name;
+    PassKind kind;
+    void (*tree)(Tree *t);
+    int (*code)(Instr *ins, int *n);    // return the number of rewrites
+} Pass;
+
+// What a slot of the pipeline did over the whole program; sizes are in nodes for the
+// AST passes and in instructions for the others
+typedef struct {
+    long long runs;
+    long long changed;
+    long long nanos;
+    long long before;
+    long long after;
+} PassStats;
+
+static void constPropPass(Tree *t);
+static void simplifyPass(Tree *t);
+static void rewritePass(Tree *t);
+static int loadPass(Instr *ins, int *n);
+static int copyPass(Instr *ins, int *n);
+static int deadPass(Instr *ins, int *n);
+
+enum { CONSTPROP, SIMPLIFY, SCHED = 5, REWRITE, NPASS };
+
+static const Pass passes[NPASS] = {
+    { "const-prop", PASS_TREE, constPropPass, NULL },
+    { "simplify", PASS_TREE, simplifyPass, NULL },
+    { "rle", PASS_CODE, NULL, loadPass },
+    { "copy-prop", PASS_CODE, NULL, copyPass },
+    { "dce", PASS_CODE, NULL, deadPass },
+    { "sched", PASS_CODE, NULL, schedulePass },
+    { "rewrite", PASS_TREE, rewritePass, NULL },
+};
+
+// The pipeline of each -O level. const-prop runs again once simplify and
+// rewrite have turned more subtrees into constants.
+static const char *levels[] = {
+    "",
+    "const-prop,simplify,rewrite,const-prop",
+    "const-prop,simplify,rewrite,const-prop,rle,copy-prop,dce,sched"
+};
+
+#define MAXPIPE 16
+
+static int pipeline[MAXPIPE];
+static int ncode = 0;                   // instruction passes in the pipeline
+static PassStats stats[MAXPIPE];
+static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+
+// const-prop has run over the statement, simplify may record facts
+static int propagated;
+
+static void constPropPass(Tree *t) {
+    constPropTree(t);
+    propagated = 1;
+}
+
+static void simplifyPass(Tree *t) {
+    simplifyTree(t, propagated);
+}
+
+static void rewritePass(Tree *t) {
+    rewriteTree(t);
+}
+
+static int isReg(const Operand *opnd, int reg) {
+    return opnd->kind == OPND_REG && opnd->val == reg;
+}
+
+// Redundant load elimination: a load of an address some register already
+// holds becomes a copy of it, or goes away if it is the same register
+static int loadPass(Instr *ins, int *n) {
+    int holds[MAXREGS], i, r, out = 0, rewrites = 0, addr;
+
+    for (r = 0; r < MAXREGS; r++) holds[r] = -1;
+    for (i = 0; i < *n; i++) {
+        Instr in = ins[i];
+
+        if (in.dst.kind == OPND_MEM) {
+            for (r = 0; r < MAXREGS; r++)
+                if (holds[r] == in.dst.val) holds[r] = -1;
+            if (in.op == OP_MOV) holds[in.src.val] = in.dst.val;
+        } else if (in.dst.kind == OPND_REG && in.op == OP_MOV && in.src.kind == OPND_MEM) {
+            addr = in.src.val;
+            if (holds[in.dst.val] == addr) {
+                rewrites++;
+                continue;
+            }
+            for (r = 0; r < MAXREGS && holds[r] != addr; r++);
+            if (r < MAXREGS) {
+                in.src.kind = OPND_REG;
+                in.src.val = r;
+                rewrites++;
+            }
+            holds[in.dst.val] = addr;
+        } else if (in.dst.kind == OPND_REG) {
+            if (in.op == OP_MOV && in.src.kind == OPND_REG) holds[in.dst.val] = holds[in.src.val];
+            else holds[in.dst.val] = -1;
+        }
+        ins[out++] = in;
+    }
+    *n = out;
+    return rewrites;
+}
+
+// Copy propagation: read the source of a copy instead of the copy while
+// neither is overwritten; copies of a register to itself go away
+static int copyPass(Instr *ins, int *n) {
+    int copyOf[MAXREGS], i, r, out = 0, rewrites = 0;
+
+    for (r = 0; r < MAXREGS; r++) copyOf[r] = -1;
+    for (i = 0; i < *n; i++) {
+        Instr in = ins[i];
+
+        if (in.src.kind == OPND_REG && copyOf[in.src.val] >= 0) {
+            in.src.val = copyOf[in.src.val];
+            rewrites++;
+        }
+        if (in.op == OP_MOV && in.dst.kind == OPND_REG && isReg(&in.src, in.dst.val)) {
+            rewrites++;
+            continue;
+        }
+        if (in.dst.kind == OPND_REG) {
+            for (r = 0; r < MAXREGS; r++)
+                if (copyOf[r] == in.dst.val) copyOf[r] = -1;
+            copyOf[in.dst.val] = in.op == OP_MOV && in.src.kind == OPND_REG ? in.src.val : -1;
+        }
+        ins[out++] = in;
+    }
+    *n = out;
+    return rewrites;
+}
+
+// Dead code elimination: a statement leaves its results in memory and in
+// the registers of promoted variables, the other registers are dead at
+// its end. Stores, EXIT and DIV, which may trap, are always kept.
+static int deadPass(Instr *ins, int *n) {
+    uint64_t live = 0, bit;
+    int i, out, removed = 0;
+
+    for (i = 0; i < sbcount; i++)
+        if (table[i].reg >= 0) live |= 1ull << table[i].reg;
+    for (i = *n - 1; i >= 0; i--) {
+        Instr *in = &ins[i];
+
+        if (in->dst.kind == OPND_REG) {
+            bit = 1ull << in->dst.val;
+            if (!(live & bit) && in->op != OP_DIV) {
+                in->op = OPCOUNT;
+                removed++;
+                continue;
+            }
+            if (in->op == OP_MOV) live &= ~bit;
+            else live |= bit;
+        }
+        if (in->src.kind == OPND_REG) live |= 1ull << in->src.val;
+    }
+    for (i = out = 0; i < *n; i++)
+        if (ins[i].op != OPCOUNT) ins[out++] = ins[i];
+    *n = out;
+    return removed;
+}
+
+static long long nowNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void record(int slot, long long start, long long before, long long after, int changed) {
+    pthread_mutex_lock(&statsLock);
+    stats[slot].runs++;
+    stats[slot].changed += changed;
+    stats[slot].nanos += nowNanos() - start;
+    stats[slot].before += before;
+    stats[slot].after += after;
+    pthread_mutex_unlock(&statsLock);
+}
+
+// FNV-1a over the nodes, to tell whether a pass changed the tree
+static uint64_t hashTree(const Tree *t) {
+    uint64_t h = 14695981039346656037ull;
+    const char *p;
+
+    for (int i = 0; i < t->n; i++) {
+        h = (h ^ t->node[i].data) * 1099511628211ull;
+        for (p = nodeLexeme(t, i); *p; p++)
+            h = (h ^ (unsigned char)*p) * 1099511628211ull;
+    }
+    return h;
+}
+
+// Run the AST passes in order. Every run of const-prop starts from the
+// facts the statement started with.
+void runTreePasses(Tree *t) {
+    long long start = 0, tick, before = 0;
+    uint64_t h = 0;
+    int i, p, nsaved = sbcount, known[TBLSIZE], val[TBLSIZE];
+
+    for (i = 0; optConstProp && i < nsaved; i++) {
+        known[i] = table[i].known;
+        val[i] = table[i].val;
+    }
+    propagated = 0;
+    for (i = 0; i < npasses; i++) {
+        p = pipeline[i];
+        if (passes[p].kind != PASS_TREE) continue;
+        if (p == CONSTPROP && propagated) {
+            for (int j = 0; j < sbcount; j++) {
+                table[j].known = j < nsaved && known[j];
+                table[j].val = j < nsaved ? val[j] : 0;
+            }
+        }
+        if (passReport) {
+            before = t->n;
+            h = hashTree(t);
+            start = nowNanos();
+        }
+        tick = traceClock();
+        passes[p].tree(t);
+        traceSpan(passes[p].name, tick, NULL, 0);
+        if (passReport)
+            record(i, start, before, t->n, hashTree(t) != h);
+    }
+}
+
+int parseProgram(Tree ***trees, int *ntrees, int *resolved) {
+    jmp_buf jb;
+    OutBuf scratch = { NULL, 0, 0 };
+    Tree *retp;
+    volatile int cap = 0, failed = 0;
+    long long start, first;
+
+    *ntrees = *resolved = 0;
+    setOutput(&scratch);
+    errorJump = &jb;
+    if (setjmp(jb) != 0) {
+        failed = 1;
+    } else {
+        while (!match(ENDFILE)) {
+            if (match(END)) {
+                advance();
+                continue;
+            }
+            start = traceClock();
+            first = tokensRead();
+            retp = newTree();
+            assign_expr(retp);
+            traceLex(start);
+            traceSpan("assign_expr", start, NULL, 0);
+            if (!match(END)) error(SYNTAXERR);
+            if (lineReport) countLine(retp, tokensRead() - first + 1);
+            runTreePasses(retp);
+            if (*ntrees == cap) {
+                cap = cap ? cap * 2 : 256;
+                *trees = (Tree**)realloc(*trees, sizeof(Tree*) * cap);
+            }
+            (*trees)[(*ntrees)++] = retp;
+            // code generation of this statement fails, nothing after it runs
+            if (!resolveSymbols(retp)) break;
+            *resolved = *ntrees;
+            advance();
+        }
+    }
+    errorJump = NULL;
+    setOutput(NULL);
+    freeOutput(&scratch);
+    return failed;
+}
+
+static _Thread_local OutBuf code;
+static _Thread_local Instr *ins;
+static _Thread_local int cap;
+
+// Parse the captured code into ins, return the count or -1 if a line is
+// not an instruction
+static int parseCode(void) {
+    char *line = code.data, *end;
+    int n = 0, ok = 1;
+
+    while (line < code.data + code.len) {
+        if ((end = strchr(line, '\n')) == NULL) return -1;
+        *end = '\0';
+        if (n == cap) {
+            ins = (Instr*)memRealloc(MEM_CODE, ins, sizeof(Instr) * cap, sizeof(Instr) * (cap ? cap * 2 : 64));
+            cap = cap ? cap * 2 : 64;
+        }
+        ok = parseInstr(line, &ins[n++]);
+        *end = '\n';
+        if (!ok) return -1;
+        line = end + 1;
+    }
+    return n;
+}
+
+// The code of a statement from a superopt rule, or by tiling or walking
+// its tree
+static void emitTree(Tree *t) {
+    if (applyRule(t)) return;
+    if (optIsel) selectTree(t);
+    else evaluateTree(t);
+}
+
+void generateCode(Tree *t) {
+    jmp_buf jb, *outer = errorJump;
+    OutBuf *saved = getOutput();
+    long long start = 0, tick;
+    int i, p, n, before, rewrites = 0, changed;
+    char line[64];
+
+    codeLine = t->line;
+    if (ncode == 0 && !lineReport) {
+        emitTree(t);
+        return;
+    }
+
+    code.len = 0;
+    setOutput(&code);
+    errorJump = &jb;
+    if (setjmp(jb) != 0) {
+        // the code up to the error and its EXIT 1 go out as they are
+        setOutput(saved);
+        errorJump = outer;
+        if (code.len > 0) emit("%.*s", (int)code.len, code.data);
+        if (outer != NULL) longjmp(*outer, 1);
+        exit(0);
+    }
+    emitTree(t);
+    setOutput(saved);
+    errorJump = outer;
+
+    if ((n = parseCode()) < 0) {
+        emit("%.*s", (int)code.len, code.data);
+        return;
+    }
+    for (i = 0; i < npasses; i++) {
+        p = pipeline[i];
+        if (passes[p].kind != PASS_CODE) continue;
+        before = n;
+        if (passReport) start = nowNanos();
+        tick = traceClock();
+        changed = passes[p].code(ins, &n);
+        traceSpan(passes[p].name, tick, NULL, 0);
+        if (passReport) record(i, start, before, n, changed > 0);
+        rewrites += changed;
+    }
+    if (lineReport) countCode(t->line, ins, n, peakRegisters());
+    // unchanged code keeps the spelling of the code generator
+    if (rewrites == 0) {
+        if (code.len > 0) emit("%.*s", (int)code.len, code.data);
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        formatInstr(&ins[i], line);
+        emit("%s\n", line);
+    }
+}
+
+static int inPipeline(int p) {
+    for (int i = 0; i < npasses; i++)
+        if (pipeline[i] == p) return 1;
+    return 0;
+}
+
+static int addPass(int p) {
+    if (npasses == MAXPIPE) return 0;
+    pipeline[npasses++] = p;
+    if (passes[p].kind == PASS_CODE) ncode++;
+    return 1;
+}
+
+static void printReport(void) {
+    long long before, after, reordered;
+    int i, p;
+
+    fprintf(stderr, "%-12s %10s %10s %10s %6s %12s %12s\n",
+        "pass", "runs", "changed", "ms", "unit", "before", "after");
+    for (i = 0; i < npasses; i++) {
+        p = pipeline[i];
+        fprintf(stderr, "%-12s %10lld %10lld %10.3f %6s %12lld %12lld\n",
+            passes[p].name, stats[i].runs, stats[i].changed, stats[i].nanos / 1e6,
+            passes[p].kind == PASS_TREE ? "nodes" : "instrs", stats[i].before, stats[i].after);
+    }
+    if (inPipeline(SCHED)) {
+        scheduleStats(&before, &after, &reordered);
+        fprintf(stderr, "sched: estimated cycles %lld -> %lld, %lld saved over %lld statements\n",
+            before, after, before - after, reordered);
+    }
+    if (inPipeline(REWRITE)) printRewriteStats();
+}
+
+int setPipeline(int level, const char *list) {
+    const char *p, *end;
+    int i;
+
+    npasses = ncode = 0;
+    if (list == NULL) list = levels[level];
+    for (p = list; *p; p = *end ? end + 1 : end) {
+        end = strchr(p, ',');
+        if (end == NULL) end = p + strlen(p);
+        for (i = 0; i < NPASS; i++)
+            if (strlen(passes[i].name) == (size_t)(end - p) && strncmp(passes[i].name, p, end - p) == 0) break;
+        if (i == NPASS || !addPass(i)) return 0;
+    }
+    if (optConstProp && !inPipeline(CONSTPROP) && !addPass(CONSTPROP)) return 0;
+    if (optSimplify && !inPipeline(SIMPLIFY) && !addPass(SIMPLIFY)) return 0;
+    optConstProp = inPipeline(CONSTPROP);
+    optSimplify = inPipeline(SIMPLIFY);
+    if (passReport) atexit(printReport);
+    return 1;
+}
+
+unsigned long long pipelineKey(void) {
+    unsigned long long key = 0;
+
+    for (int i = 0; i < npasses; i++)
+        key = key << 3 | (unsigned long long)(pipeline[i] + 1);
+    return key;
+}
+
+// Filled on first use, 32 bytes as the file headers store it
+static char stamp[32];
+
+const char *buildStamp(void) {
+#ifdef BUILD_ID
+    if (stamp[0] == '\0') strncpy(stamp, BUILD_ID, sizeof(stamp) - 1);
+#else
+    uint64_t hash = 14695981039346656037ULL;    // FNV-1a over every byte
+    unsigned char buf[65536];
+    ssize_t n;
+    int fd;
+
+    if (stamp[0] != '\0') return stamp;
+    fd = open("/proc/self/exe", O_RDONLY);
+    if (fd < 0) {
+        // no way to tell builds apart, match only this run's build time
+        strncpy(stamp, __DATE__ " " __TIME__, sizeof(stamp) - 1);
+        return stamp;
+    }
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        for (ssize_t i = 0; i < n; i++)
+            hash = (hash ^ buf[i]) * 1099511628211ULL;
+    close(fd);
+    snprintf(stamp, sizeof(stamp), "exe %016llx", (unsigned long long)hash);
+#endif
+    return stamp;
+}
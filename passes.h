@@ -0,0 +1,40 @@
+#ifndef __PASSES__
+#define __PASSES__
+
+#include "parser.h"
+
+// Passes in the pipeline, run in order on every statement: AST passes
+// after parsing, instruction passes over the code of the statement
+extern int npasses;
+
+// Enabled with -fpass-report: print the time and effect of every pass
+// to stderr when the program ends
+extern int passReport;
+
+// Build the pipeline of -O level, or of a comma separated list of pass
+// names if list is not NULL; -fconst-prop and -fsimplify add their pass.
+// Return 0 on an unknown name or more than 16 passes
+extern int setPipeline(int level, const char *list);
+
+// Identifies the pipeline, for the compile cache
+extern unsigned long long pipelineKey(void);
+
+// Identifies the build of the compiler, for the files that keep code
+// across runs: -DBUILD_ID="..." if given, else a hash of the executable
+extern const char *buildStamp(void);
+
+// Run the AST passes over one statement
+extern void runTreePasses(Tree *t);
+
+// Parse the whole input into *trees, running the AST passes over every
+// statement and assigning addresses, as the compiles that see the whole
+// program first need. Stops after a statement whose code will fail; the
+// first *resolved trees have all their variables defined. Return 1 if it
+// stops on an error that prints EXIT 1 after the statements before it
+extern int parseProgram(Tree ***trees, int *ntrees, int *resolved);
+
+// Generate the code of a statement, then run the instruction passes over
+// it and count it for the line report
+extern void generateCode(Tree *t);
+
+#endif // __PASSES__
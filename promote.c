@@ -0,0 +1,203 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "promote.h"
+#include "codeGen.h"
+#include "passes.h"
+#include "trace.h"
+
+int optPromote = 0;
+
+// A variable kept in a dedicated register
+typedef struct {
+    int idx;
+    int uses;
+    int reg;
+    int valid;      // the register holds the value of the variable
+    int dirty;      // the register is newer than memory
+} Promoted;
+
+static Promoted prom[TBLSIZE];
+static int nprom = 0;
+static Tree **trees = NULL;
+static int ntrees = 0;
+
+static void countUses(Tree *t, int *uses) {
+    int idx;
+    for (int i = 0; i < t->n; i++)
+        if (t->node[i].data == ID && (idx = getvariable(nodeLexeme(t, i))) != -1) uses[idx]++;
+}
+
+static int assigns(Tree *t, int idx) {
+    for (int i = 0; i < t->n; i++)
+        if ((t->node[i].flags & NODE_TARGET) && getvariable(nodeLexeme(t, i)) == idx) return 1;
+    return 0;
+}
+
+// Registers evaluateTree allocates for the tree, given the variables in
+// registers, worked out bottom up
+static int needRegs(Tree *t) {
+    int *need = (int*)treeScratch(t, sizeof(int));
+    int i, l, r, varidx;
+
+    for (i = 0; i < t->n; i++) {
+        BTNode *node = &t->node[i];
+        switch (node->data) {
+        case ID:
+        case INT:
+            need[i] = 1;
+            break;
+        case ASSIGN:
+            need[i] = need[node->right];
+            break;
+        case ADDSUB_ASSIGN:
+        case UNARY:
+            r = need[node->right];
+            varidx = getvariable(nodeLexeme(t, node->left));
+            need[i] = (varidx != -1 && table[varidx].reg >= 0) || r > 2 ? r : 2;
+            break;
+        default:
+            l = need[node->left];
+            r = 1 + need[node->right];
+            if (t->node[node->right].data == ID && (varidx = getvariable(nodeLexeme(t, node->right))) != -1 &&
+                table[varidx].reg >= 0) r = l;
+            need[i] = l > r ? l : r;
+            break;
+        }
+    }
+    return need[t->n - 1];
+}
+
+// Pick the most used variables, at least two uses each
+static void choosePromoted(void) {
+    int uses[TBLSIZE] = { 0 };
+    int i, j, limit = optPromote < 0 ? targetRegs - 2 : optPromote;
+    Promoted p;
+
+    if (limit > targetRegs - 1) limit = targetRegs - 1;
+    for (i = 0; i < ntrees; i++)
+        countUses(trees[i], uses);
+    nprom = 0;
+    for (i = 0; i < sbcount; i++) {
+        if (uses[i] < 2) continue;
+        prom[nprom].idx = i;
+        prom[nprom].uses = uses[i];
+        prom[nprom].valid = prom[nprom].dirty = 0;
+        // insertion sort, most used first
+        for (j = nprom++; j > 0 && prom[j - 1].uses < prom[j].uses; j--) {
+            p = prom[j];
+            prom[j] = prom[j - 1];
+            prom[j - 1] = p;
+        }
+    }
+    if (nprom > limit) nprom = limit > 0 ? limit : 0;
+    for (i = 0; i < nprom; i++)
+        prom[i].reg = targetRegs - 1 - i;
+}
+
+static void spill(Promoted *p) {
+    if (p->valid && p->dirty) emit("%s [%d] r%d\n", backend->mnemonic[OP_MOV], varAddress(p->idx), p->reg);
+    p->dirty = 0;
+    table[p->idx].reg = -1;
+}
+
+// End the program on an error: the deferred stores go out before EXIT 1
+static void failProgram(void) {
+    for (int j = 0; j < nprom; j++)
+        spill(&prom[j]);
+    emit("%s 1\n", backend->mnemonic[OP_EXIT]);
+    exit(0);
+}
+
+// Mark the variables of the first m promoted whose register the code
+// writes; the first line is the prefix
+static void markWritten(const OutBuf *code, int m) {
+    const char *line = (const char*)memchr(code->data, '\n', code->len), *end = code->data + code->len;
+    int reg;
+
+    while (line != NULL && ++line < end) {
+        if (sscanf(line, "%*s r%d", &reg) == 1)
+            for (int j = 0; j < m; j++)
+                if (prom[j].reg == reg) prom[j].valid = prom[j].dirty = 1;
+        line = (const char*)memchr(line, '\n', end - line);
+    }
+}
+
+// Compile a statement; if its code fails, the variables it assigned
+// before the error are spilled with the others
+static void compileOrFail(Tree *t, int m) {
+    static OutBuf code = { NULL, 0, 0 };
+    jmp_buf jb;
+
+    code.len = 0;
+    setOutput(&code);
+    errorJump = &jb;
+    if (setjmp(jb) != 0) {
+        setOutput(NULL);
+        errorJump = NULL;
+        // err ended the code with EXIT 1, which goes after the spills
+        code.len -= strlen(backend->mnemonic[OP_EXIT]) + strlen(" 1\n");
+        code.data[code.len] = '\0';
+        emit("%s", code.data);
+        markWritten(&code, m);
+        failProgram();
+    }
+    compileStatement(t);
+    setOutput(NULL);
+    errorJump = NULL;
+    emit("%.*s", (int)code.len, code.data);
+}
+
+void compilePromoted(void) {
+    long long start = traceClock();
+    int resolved, failed = parseProgram(&trees, &ntrees, &resolved), i, j, m, written[TBLSIZE];
+
+    traceSpan("parseProgram", start, "statements", ntrees);
+    start = traceClock();
+    choosePromoted();
+    traceSpan("choosePromoted", start, "promoted", nprom);
+    // x, y and z start in memory, the others are first assigned
+    for (j = 0; j < nprom; j++)
+        if (prom[j].idx < 3) {
+            emit("%s r%d [%d]\n", backend->mnemonic[OP_MOV], prom[j].reg, varAddress(prom[j].idx));
+            prom[j].valid = 1;
+        }
+
+    for (i = 0; i < ntrees; i++) {
+        start = traceClock();
+        for (j = 0; j < nprom; j++) {
+            table[prom[j].idx].reg = prom[j].reg;
+            written[j] = assigns(trees[i], prom[j].idx);
+        }
+        // free the registers of the least used variables for the temporaries
+        for (m = nprom; m > 0 && needRegs(trees[i]) > targetRegs - m; m--)
+            spill(&prom[m - 1]);
+
+        resetRegister();
+        compileOrFail(trees[i], m);
+        freeTree(trees[i]);
+
+        for (j = 0; j < nprom; j++) {
+            if (!written[j]) continue;
+            prom[j].valid = 1;
+            if (j < m) prom[j].dirty = 1;
+        }
+        for (j = m; j < nprom; j++)
+            if (prom[j].valid) emit("%s r%d [%d]\n", backend->mnemonic[OP_MOV], prom[j].reg, varAddress(prom[j].idx));
+        traceSpan("compileStatement", start, "n", i + 1);
+    }
+    if (failed) failProgram();
+
+    for (j = 0; j < nprom; j++)
+        spill(&prom[j]);
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < nprom && prom[j].idx != i; j++);
+        if (j < nprom && prom[j].valid && prom[j].reg >= 3)
+            emit("%s r%d r%d\n", backend->mnemonic[OP_MOV], i, prom[j].reg);
+        else
+            emit("%s r%d [%d]\n", backend->mnemonic[OP_MOV], i, varAddress(i));
+    }
+    emit("%s 0\n", backend->mnemonic[OP_EXIT]);
+    exit(0);
+}
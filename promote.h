@@ -0,0 +1,14 @@
+#ifndef __PROMOTE__
+#define __PROMOTE__
+
+// Enabled with -fpromote[=N]: number of variables to keep in registers,
+// -1 to use all registers but two
+extern int optPromote;
+
+// Compile the whole program keeping the most used variables in dedicated
+// registers; their stores are deferred until the end of the program, an
+// error or until a statement needs their register. Exits like statement
+// does.
+extern void compilePromoted(void);
+
+#endif // __PROMOTE__
@@ -0,0 +1,130 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include "push.h"
+#include "codeGen.h"
+#include "memstat.h"
+
+// Statements end at a newline, so the only state kept between pushes is
+// the unfinished line; a complete line is parsed from memory in one go
+struct PushStream {
+    CodeCallback cb;
+    void *ctx;
+    char *line;
+    size_t len;
+    size_t cap;
+    int ended;
+    int count;                  // sbcount of this program
+    Symbol symbols[TBLSIZE];
+};
+
+// Compile the statements of text with the symbol table of s; last is
+// set at the end of the input
+static void compileText(PushStream *s, const char *text, size_t n, int last) {
+    Symbol *savedTable = table;
+    int savedCount = sbcount;
+    OutBuf out = { NULL, 0, 0 };
+    jmp_buf jb;
+
+    table = s->symbols;
+    sbcount = s->count;
+    resetRegister();
+    setOutput(&out);
+    errorJump = &jb;
+    if (setjmp(jb) != 0) {
+        s->ended = 1;
+    } else {
+        setLexBuffer(text, n);
+        while (!match(ENDFILE))
+            statement();
+        // ENDFILE before the end of the text is an EOF byte
+        if (last || !lexAtEnd()) {
+            endProgram();
+            s->ended = 1;
+        }
+    }
+    errorJump = NULL;
+    setOutput(NULL);
+    s->count = sbcount;
+    table = savedTable;
+    sbcount = savedCount;
+    if (out.len > 0) s->cb(s->ctx, out.data, out.len);
+    freeOutput(&out);
+}
+
+PushStream *openStream(CodeCallback cb, void *ctx) {
+    PushStream *s = (PushStream*)memRealloc(MEM_SYMBOLS, NULL, 0, sizeof(PushStream));
+    Symbol *savedTable = table;
+    int savedCount = sbcount;
+
+    memset(s, 0, sizeof(PushStream));
+    s->cb = cb;
+    s->ctx = ctx;
+    table = s->symbols;
+    initTable();
+    s->count = sbcount;
+    table = savedTable;
+    sbcount = savedCount;
+    return s;
+}
+
+int pushBytes(PushStream *s, const char *data, size_t len) {
+    const char *nl;
+    size_t n;
+
+    while (!s->ended && len > 0) {
+        nl = (const char*)memchr(data, '\n', len);
+        n = nl != NULL ? (size_t)(nl - data) + 1 : len;
+        if (nl != NULL && s->len == 0) {
+            // a whole line in this chunk needs no copy
+            compileText(s, data, n, 0);
+        } else {
+            if (s->len + n > s->cap) {
+                s->line = (char*)memRealloc(MEM_LEX, s->line, s->cap, (s->len + n) * 2);
+                s->cap = (s->len + n) * 2;
+            }
+            memcpy(s->line + s->len, data, n);
+            s->len += n;
+            if (nl != NULL) {
+                compileText(s, s->line, s->len, 0);
+                s->len = 0;
+            }
+        }
+        data += n;
+        len -= n;
+    }
+    return !s->ended;
+}
+
+void closeStream(PushStream *s) {
+    if (!s->ended) compileText(s, s->len > 0 ? s->line : "", s->len, 1);
+    memFree(MEM_LEX, s->line, s->cap);
+    memFree(MEM_SYMBOLS, s, sizeof(PushStream));
+}
+
+static void writeCode(void *ctx, const char *code, size_t len) {
+    (void)ctx;
+    fwrite(code, 1, len, stdout);
+}
+
+void compilePushed(void) {
+    PushStream *s = openStream(writeCode, NULL);
+    struct pollfd pfd = { 0, POLLIN, 0 };
+    char buf[1 << 16];
+    ssize_t n;
+
+    while (1) {
+        // a read after poll returns what is there without waiting for more
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) break;
+        n = read(0, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0 || !pushBytes(s, buf, (size_t)n)) break;
+        fflush(stdout);
+    }
+    closeStream(s);
+    exit(0);
+}
@@ -0,0 +1,29 @@
+#ifndef __PUSH__
+#define __PUSH__
+
+#include <stddef.h>
+
+// Receives the code of every completed line of a stream, including the
+// EXIT that ends the program
+typedef void (*CodeCallback)(void *ctx, const char *code, size_t len);
+
+// A program fed by the caller in pieces, with its own symbol table
+typedef struct PushStream PushStream;
+
+// Start a program whose code is passed to cb with ctx
+extern PushStream *openStream(CodeCallback cb, void *ctx);
+
+// Feed any number of bytes; a statement or token may be split anywhere.
+// Return 0 once the program has ended (after an error or an EOF byte),
+// the rest of the input is then ignored
+extern int pushBytes(PushStream *s, const char *data, size_t len);
+
+// End of input: compile an unterminated last line, end the program
+// unless it already ended, and free the stream
+extern void closeStream(PushStream *s);
+
+// Compile stdin through the push API, reading whatever is available
+// without blocking in a poll loop. Exits like statement does.
+extern void compilePushed(void);
+
+#endif // __PUSH__
@@ -0,0 +1,147 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "rewrite.h"
+#include "memstat.h"
+
+// Rewrites of a node before moving on, in case rules undo each other
+#define MAXTRIES 8
+#define MAXSTACK 32
+
+static pthread_mutex_t firedLock = PTHREAD_MUTEX_INITIALIZER;
+
+// The nodes array of the last statement, reused for the next one
+static _Thread_local BTNode *spare = NULL;
+static _Thread_local int spareCap = 0;
+
+// The subtree being rewritten, nodes first .. first + nheld - 1 of the tree
+static _Thread_local BTNode *held = NULL;
+static _Thread_local int heldCap = 0, heldFirst, heldFlags;
+static _Thread_local int stack[MAXSTACK], depth;
+
+static const char *opText[OPCOUNT] = {
+    "", "+", "-", "*", "/", "&", "|", "^"
+};
+
+static int pushNode(Tree *t, const BTNode *node) {
+    int cap;
+
+    if (t->n == t->cap) {
+        cap = t->cap ? t->cap * 2 : 16;
+        t->node = (BTNode*)memRealloc(MEM_AST, t->node, sizeof(BTNode) * t->cap, sizeof(BTNode) * cap);
+        t->cap = cap;
+    }
+    t->node[t->n] = *node;
+    return t->n++;
+}
+
+int nodeClass(const Tree *t, int i) {
+    switch (t->node[i].data) {
+    case ADDSUB:
+    case MULDIV:
+    case AND:
+    case OR:
+    case XOR:
+        return t->node[i].op;
+    case INT:
+        return CLASS_INT;
+    default:
+        return CLASS_OTHER;
+    }
+}
+
+void beginRewrite(Tree *t, int root) {
+    int first = firstNode(t, root), n = root - first + 1;
+
+    if (n > heldCap) {
+        held = (BTNode*)memRealloc(MEM_AST, held, sizeof(BTNode) * heldCap, sizeof(BTNode) * n * 2);
+        heldCap = n * 2;
+    }
+    memcpy(held, &t->node[first], sizeof(BTNode) * n);
+    heldFirst = first;
+    heldFlags = t->node[root].flags & NODE_OPERAND;
+    t->n = first;
+    depth = 0;
+}
+
+void rewriteCopy(Tree *t, int i) {
+    int last = i - heldFirst, j = last, shift;
+    BTNode node;
+
+    while (held[j].left >= 0) j = held[j].left - heldFirst;
+    shift = t->n - (j + heldFirst);
+    for (; j <= last; j++) {
+        node = held[j];
+        if (node.left >= 0) node.left += shift;
+        if (node.right >= 0) node.right += shift;
+        pushNode(t, &node);
+    }
+    t->node[t->n - 1].flags &= ~NODE_OPERAND;
+    stack[depth++] = t->n - 1;
+}
+
+void rewriteConst(Tree *t, int val) {
+    BTNode node = { INT, 0, OP_MOV, 0, -1, -1, 0 };
+    char buf[16];
+
+    sprintf(buf, "%d", val);
+    node.lexeme = addText(t, buf);
+    stack[depth++] = pushNode(t, &node);
+}
+
+void rewriteOp(Tree *t, Opcode op) {
+    BTNode node = { 0, 0, 0, 0, -1, -1, 0 };
+
+    node.right = stack[--depth];
+    node.left = stack[--depth];
+    node.data = op == OP_ADD || op == OP_SUB ? ADDSUB : op == OP_MUL || op == OP_DIV ? MULDIV :
+        op == OP_AND ? AND : op == OP_OR ? OR : XOR;
+    node.op = (uint8_t)op;
+    node.lexeme = addText(t, opText[op]);
+    t->node[node.right].flags |= NODE_OPERAND;
+    stack[depth++] = pushNode(t, &node);
+}
+
+void endRewrite(Tree *t) {
+    t->node[t->n - 1].flags |= heldFlags;
+}
+
+// Copy the nodes in postfix order to a new array, trying the rules at
+// every node once its children are rewritten. Copies of the subtrees a
+// rule keeps are made from the held nodes, so the new array only grows
+// at its end.
+int rewriteTree(Tree *t) {
+    int *to = (int*)treeScratch(t, sizeof(int));
+    Tree out = *t;
+    BTNode node;
+    int i, r, tries, fired = 0;
+
+    out.node = spare;
+    out.cap = spareCap;
+    out.n = 0;
+    for (i = 0; i < t->n; i++) {
+        node = t->node[i];
+        if (node.left >= 0) node.left = to[node.left];
+        if (node.right >= 0) node.right = to[node.right];
+        pushNode(&out, &node);
+        for (tries = 0; tries < MAXTRIES && (r = matchRewrite(&out, out.n - 1)) >= 0; tries++) {
+            pthread_mutex_lock(&firedLock);
+            rewriteFired[r]++;
+            pthread_mutex_unlock(&firedLock);
+            fired++;
+        }
+        to[i] = out.n - 1;
+    }
+    spare = t->node;
+    spareCap = t->cap;
+    *t = out;
+    return fired;
+}
+
+void printRewriteStats(void) {
+    fprintf(stderr, "%-18s %10s  %s\n", "line", "fired", "rule");
+    for (int r = 0; r < nrewrites; r++)
+        fprintf(stderr, "rewrite.rules:%-4d %10lld  %s\n", rewriteLine[r], rewriteFired[r], rewriteRule[r]);
+}
@@ -0,0 +1,43 @@
+#ifndef __REWRITE__
+#define __REWRITE__
+
+#include "parser.h"
+
+// The rules of rewrite.rules, compiled by rulegen into rewriteMatch.c
+extern const int nrewrites;
+extern const char *rewriteRule[];
+extern const int rewriteLine[];     // in rewrite.rules
+
+// Times each rule fired over the program
+extern long long rewriteFired[];
+
+// Classes of a node the generated matcher switches on: the Opcode of a
+// binary operator, CLASS_INT for a constant, CLASS_OTHER for the rest
+#define CLASS_INT OPCOUNT
+#define CLASS_OTHER (OPCOUNT + 1)
+
+#define pow2(v) ((v) > 0 && ((v) & ((v) - 1)) == 0)
+
+// Rewrite the subtree rooted at n, the last node of t, by the first rule
+// that matches it; return the rule, -1 if none does
+extern int matchRewrite(Tree *t, int n);
+
+// Rewrite a statement bottom-up; return the number of rewrites
+extern int rewriteTree(Tree *t);
+
+// Print how often each rule fired to stderr
+extern void printRewriteStats(void);
+
+// The replacement of a rule is built in postfix order over the subtree at
+// the top of t: beginRewrite takes the subtree off, rewriteCopy puts back
+// a copy of its node i with its children, rewriteConst a constant and
+// rewriteOp an operator over the last two, endRewrite gives the result
+// the place of the subtree under its parent
+extern int nodeClass(const Tree *t, int i);
+extern void beginRewrite(Tree *t, int root);
+extern void rewriteCopy(Tree *t, int i);
+extern void rewriteConst(Tree *t, int val);
+extern void rewriteOp(Tree *t, Opcode op);
+extern void endRewrite(Tree *t);
+
+#endif // __REWRITE__
@@ -0,0 +1,2368 @@
+// Generated by rulegen from rewrite.rules, do not edit
+#include "rewrite.h"
+#include "opt.h"
+
+const int nrewrites = 60;
+
+const char *rewriteRule[] = {
+    "c1 + c2 => c1 + c2",
+    "c1 - c2 => c1 - c2",
+    "c1 * c2 => c1 * c2",
+    "c1 / c2 => c1 / c2",
+    "c1 & c2 => c1 & c2",
+    "c1 | c2 => c1 | c2",
+    "c1 ^ c2 => c1 ^ c2",
+    "c + x => x + c",
+    "c * x => x * c",
+    "c & x => x & c",
+    "c | x => x | c",
+    "c ^ x => x ^ c",
+    "x + 0 => x",
+    "x - 0 => x",
+    "x * 1 => x",
+    "x * 0 => 0",
+    "x / 1 => x",
+    "x & 0 => 0",
+    "x & -1 => x",
+    "x | 0 => x",
+    "x | -1 => -1",
+    "x ^ 0 => x",
+    "x - x => 0",
+    "x ^ x => 0",
+    "x & x => x",
+    "x | x => x",
+    "(x + c1) + c2 => x + (c1 + c2)",
+    "(x + c1) - c2 => x + (c1 - c2)",
+    "(x - c1) + c2 => x - (c1 - c2)",
+    "(x - c1) - c2 => x - (c1 + c2)",
+    "(c1 - x) + c2 => (c1 + c2) - x",
+    "(c1 - x) - c2 => (c1 - c2) - x",
+    "(x * c1) * c2 => x * (c1 * c2)",
+    "(x & c1) & c2 => x & (c1 & c2)",
+    "(x | c1) | c2 => x | (c1 | c2)",
+    "(x ^ c1) ^ c2 => x ^ (c1 ^ c2)",
+    "(x / c1) / c2 => x / (c1 * c2) if c1 > 0 && c2 > 0 && c1 * c2 <= 2147483647",
+    "0 - (0 - x) => x",
+    "x - (0 - y) => x + y",
+    "x + (0 - y) => x - y",
+    "(0 - x) * c => x * (0 - c)",
+    "(x + y) - y => x",
+    "(x - y) + y => x",
+    "(x ^ y) ^ y => x",
+    "x - (x - y) => y",
+    "x - (x + y) => 0 - y",
+    "(x + c) - x => c",
+    "x + x => x * 2",
+    "(x * c) + x => x * (c + 1)",
+    "x + (x * c) => x * (c + 1)",
+    "(x * c) - x => x * (c - 1)",
+    "(x * c1) + (x * c2) => x * (c1 + c2)",
+    "(x * c1) - (x * c2) => x * (c1 - c2)",
+    "(x & c1) | (x & c2) => x & (c1 | c2)",
+    "(x & c1) ^ (x & c2) => x & (c1 ^ c2)",
+    "(x | c1) & (x | c2) => x | (c1 & c2)",
+    "(x | c1) & c2 => x & c2 if (c1 & c2) == 0",
+    "(x ^ c1) & c2 => x & c2 if (c1 & c2) == 0",
+    "(x & c1) | c2 => x | c2 if (c1 | c2) == -1",
+    "(x * c1) & c2 => 0 if pow2(c1) && (c2 & -c1) == 0",
+};
+
+const int rewriteLine[] = {
+    21, 22, 23, 24, 25, 26, 27, 30, 31, 32, 33, 34, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 53, 54, 55, 56, 57, 58,
+    59, 60, 61, 62, 63, 66, 67, 68, 69, 72, 73, 74, 75, 76, 77, 80,
+    81, 82, 83, 84, 85, 86, 87, 88, 91, 92, 93, 94
+};
+
+long long rewriteFired[60];
+
+int matchRewrite(Tree *t, int n) {
+    int nl = -1, nll = -1, nlr = -1, nr = -1, nrl = -1, nrr = -1;
+    int k[1];
+
+    switch (nodeClass(t, n)) {
+    case OP_ADD:
+        nl = t->node[n].left;
+        nr = t->node[n].right;
+        switch (nodeClass(t, nl)) {
+        case CLASS_INT:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:21: c1 + c2 => c1 + c2
+                if (applyOp(OP_ADD, intValue(t, nl), intValue(t, nr), &k[0])) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, k[0]);
+                    endRewrite(t);
+                    return 0;
+                }
+                // rewrite.rules:30: c + x => x + c
+                beginRewrite(t, n);
+                rewriteCopy(t, nr);
+                rewriteCopy(t, nl);
+                rewriteOp(t, OP_ADD);
+                endRewrite(t);
+                return 7;
+            case OP_SUB:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:30: c + x => x + c
+                beginRewrite(t, n);
+                rewriteCopy(t, nr);
+                rewriteCopy(t, nl);
+                rewriteOp(t, OP_ADD);
+                endRewrite(t);
+                return 7;
+            case OP_MUL:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:30: c + x => x + c
+                beginRewrite(t, n);
+                rewriteCopy(t, nr);
+                rewriteCopy(t, nl);
+                rewriteOp(t, OP_ADD);
+                endRewrite(t);
+                return 7;
+            default:
+                // rewrite.rules:30: c + x => x + c
+                beginRewrite(t, n);
+                rewriteCopy(t, nr);
+                rewriteCopy(t, nl);
+                rewriteOp(t, OP_ADD);
+                endRewrite(t);
+                return 7;
+            }
+            break;
+        case OP_ADD:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:37: x + 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 12;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:53: (x + c1) + c2 => x + (c1 + c2)
+                    if (applyOp(OP_ADD, intValue(t, nlr), intValue(t, nr), &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_ADD);
+                        endRewrite(t);
+                        return 26;
+                    }
+                    // rewrite.rules:80: x + x => x * 2
+                    if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, 2);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 47;
+                    }
+                    break;
+                default:
+                    // rewrite.rules:80: x + x => x * 2
+                    if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, 2);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 47;
+                    }
+                    break;
+                }
+                break;
+            case OP_SUB:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                switch (nodeClass(t, nrl)) {
+                case CLASS_INT:
+                    // rewrite.rules:68: x + (0 - y) => x - y
+                    if (intValue(t, nrl) == 0) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteCopy(t, nrr);
+                        rewriteOp(t, OP_SUB);
+                        endRewrite(t);
+                        return 39;
+                    }
+                    // rewrite.rules:80: x + x => x * 2
+                    if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, 2);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 47;
+                    }
+                    break;
+                default:
+                    // rewrite.rules:80: x + x => x * 2
+                    if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, 2);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 47;
+                    }
+                    break;
+                }
+                break;
+            case OP_MUL:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:80: x + x => x * 2
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    rewriteConst(t, 2);
+                    rewriteOp(t, OP_MUL);
+                    endRewrite(t);
+                    return 47;
+                }
+                switch (nodeClass(t, nrr)) {
+                case CLASS_INT:
+                    // rewrite.rules:82: x + (x * c) => x * (c + 1)
+                    if (sameTree(t, nl, nrl) && droppable(t, nl) && applyOp(OP_ADD, intValue(t, nrr), 1, &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 49;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:80: x + x => x * 2
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    rewriteConst(t, 2);
+                    rewriteOp(t, OP_MUL);
+                    endRewrite(t);
+                    return 47;
+                }
+                break;
+            }
+            break;
+        case OP_SUB:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:37: x + 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 12;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:55: (x - c1) + c2 => x - (c1 - c2)
+                    if (applyOp(OP_SUB, intValue(t, nlr), intValue(t, nr), &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_SUB);
+                        endRewrite(t);
+                        return 28;
+                    }
+                    switch (nodeClass(t, nll)) {
+                    case CLASS_INT:
+                        // rewrite.rules:57: (c1 - x) + c2 => (c1 + c2) - x
+                        if (applyOp(OP_ADD, intValue(t, nll), intValue(t, nr), &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteConst(t, k[0]);
+                            rewriteCopy(t, nlr);
+                            rewriteOp(t, OP_SUB);
+                            endRewrite(t);
+                            return 30;
+                        }
+                        // rewrite.rules:73: (x - y) + y => x
+                        if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            endRewrite(t);
+                            return 42;
+                        }
+                        // rewrite.rules:80: x + x => x * 2
+                        if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nl);
+                            rewriteConst(t, 2);
+                            rewriteOp(t, OP_MUL);
+                            endRewrite(t);
+                            return 47;
+                        }
+                        break;
+                    default:
+                        // rewrite.rules:73: (x - y) + y => x
+                        if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            endRewrite(t);
+                            return 42;
+                        }
+                        // rewrite.rules:80: x + x => x * 2
+                        if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nl);
+                            rewriteConst(t, 2);
+                            rewriteOp(t, OP_MUL);
+                            endRewrite(t);
+                            return 47;
+                        }
+                        break;
+                    }
+                    break;
+                default:
+                    switch (nodeClass(t, nll)) {
+                    case CLASS_INT:
+                        // rewrite.rules:57: (c1 - x) + c2 => (c1 + c2) - x
+                        if (applyOp(OP_ADD, intValue(t, nll), intValue(t, nr), &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteConst(t, k[0]);
+                            rewriteCopy(t, nlr);
+                            rewriteOp(t, OP_SUB);
+                            endRewrite(t);
+                            return 30;
+                        }
+                        // rewrite.rules:73: (x - y) + y => x
+                        if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            endRewrite(t);
+                            return 42;
+                        }
+                        // rewrite.rules:80: x + x => x * 2
+                        if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nl);
+                            rewriteConst(t, 2);
+                            rewriteOp(t, OP_MUL);
+                            endRewrite(t);
+                            return 47;
+                        }
+                        break;
+                    default:
+                        // rewrite.rules:73: (x - y) + y => x
+                        if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            endRewrite(t);
+                            return 42;
+                        }
+                        // rewrite.rules:80: x + x => x * 2
+                        if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nl);
+                            rewriteConst(t, 2);
+                            rewriteOp(t, OP_MUL);
+                            endRewrite(t);
+                            return 47;
+                        }
+                        break;
+                    }
+                    break;
+                }
+                break;
+            case OP_SUB:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                switch (nodeClass(t, nrl)) {
+                case CLASS_INT:
+                    // rewrite.rules:68: x + (0 - y) => x - y
+                    if (intValue(t, nrl) == 0) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteCopy(t, nrr);
+                        rewriteOp(t, OP_SUB);
+                        endRewrite(t);
+                        return 39;
+                    }
+                    // rewrite.rules:73: (x - y) + y => x
+                    if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        endRewrite(t);
+                        return 42;
+                    }
+                    // rewrite.rules:80: x + x => x * 2
+                    if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, 2);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 47;
+                    }
+                    break;
+                default:
+                    // rewrite.rules:73: (x - y) + y => x
+                    if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        endRewrite(t);
+                        return 42;
+                    }
+                    // rewrite.rules:80: x + x => x * 2
+                    if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, 2);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 47;
+                    }
+                    break;
+                }
+                break;
+            case OP_MUL:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:73: (x - y) + y => x
+                if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nll);
+                    endRewrite(t);
+                    return 42;
+                }
+                // rewrite.rules:80: x + x => x * 2
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    rewriteConst(t, 2);
+                    rewriteOp(t, OP_MUL);
+                    endRewrite(t);
+                    return 47;
+                }
+                switch (nodeClass(t, nrr)) {
+                case CLASS_INT:
+                    // rewrite.rules:82: x + (x * c) => x * (c + 1)
+                    if (sameTree(t, nl, nrl) && droppable(t, nl) && applyOp(OP_ADD, intValue(t, nrr), 1, &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 49;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:73: (x - y) + y => x
+                if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nll);
+                    endRewrite(t);
+                    return 42;
+                }
+                // rewrite.rules:80: x + x => x * 2
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    rewriteConst(t, 2);
+                    rewriteOp(t, OP_MUL);
+                    endRewrite(t);
+                    return 47;
+                }
+                break;
+            }
+            break;
+        case OP_MUL:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:37: x + 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 12;
+                }
+                // rewrite.rules:80: x + x => x * 2
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    rewriteConst(t, 2);
+                    rewriteOp(t, OP_MUL);
+                    endRewrite(t);
+                    return 47;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:81: (x * c) + x => x * (c + 1)
+                    if (sameTree(t, nll, nr) && droppable(t, nll) && applyOp(OP_ADD, intValue(t, nlr), 1, &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 48;
+                    }
+                    break;
+                }
+                break;
+            case OP_SUB:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                switch (nodeClass(t, nrl)) {
+                case CLASS_INT:
+                    // rewrite.rules:68: x + (0 - y) => x - y
+                    if (intValue(t, nrl) == 0) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteCopy(t, nrr);
+                        rewriteOp(t, OP_SUB);
+                        endRewrite(t);
+                        return 39;
+                    }
+                    // rewrite.rules:80: x + x => x * 2
+                    if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, 2);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 47;
+                    }
+                    switch (nodeClass(t, nlr)) {
+                    case CLASS_INT:
+                        // rewrite.rules:81: (x * c) + x => x * (c + 1)
+                        if (sameTree(t, nll, nr) && droppable(t, nll) && applyOp(OP_ADD, intValue(t, nlr), 1, &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            rewriteConst(t, k[0]);
+                            rewriteOp(t, OP_MUL);
+                            endRewrite(t);
+                            return 48;
+                        }
+                        break;
+                    }
+                    break;
+                default:
+                    // rewrite.rules:80: x + x => x * 2
+                    if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, 2);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 47;
+                    }
+                    switch (nodeClass(t, nlr)) {
+                    case CLASS_INT:
+                        // rewrite.rules:81: (x * c) + x => x * (c + 1)
+                        if (sameTree(t, nll, nr) && droppable(t, nll) && applyOp(OP_ADD, intValue(t, nlr), 1, &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            rewriteConst(t, k[0]);
+                            rewriteOp(t, OP_MUL);
+                            endRewrite(t);
+                            return 48;
+                        }
+                        break;
+                    }
+                    break;
+                }
+                break;
+            case OP_MUL:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:80: x + x => x * 2
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    rewriteConst(t, 2);
+                    rewriteOp(t, OP_MUL);
+                    endRewrite(t);
+                    return 47;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:81: (x * c) + x => x * (c + 1)
+                    if (sameTree(t, nll, nr) && droppable(t, nll) && applyOp(OP_ADD, intValue(t, nlr), 1, &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 48;
+                    }
+                    switch (nodeClass(t, nrr)) {
+                    case CLASS_INT:
+                        // rewrite.rules:82: x + (x * c) => x * (c + 1)
+                        if (sameTree(t, nl, nrl) && droppable(t, nl) && applyOp(OP_ADD, intValue(t, nrr), 1, &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nl);
+                            rewriteConst(t, k[0]);
+                            rewriteOp(t, OP_MUL);
+                            endRewrite(t);
+                            return 49;
+                        }
+                        // rewrite.rules:84: (x * c1) + (x * c2) => x * (c1 + c2)
+                        if (sameTree(t, nll, nrl) && droppable(t, nll) && applyOp(OP_ADD, intValue(t, nlr), intValue(t, nrr), &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            rewriteConst(t, k[0]);
+                            rewriteOp(t, OP_MUL);
+                            endRewrite(t);
+                            return 51;
+                        }
+                        break;
+                    }
+                    break;
+                default:
+                    switch (nodeClass(t, nrr)) {
+                    case CLASS_INT:
+                        // rewrite.rules:82: x + (x * c) => x * (c + 1)
+                        if (sameTree(t, nl, nrl) && droppable(t, nl) && applyOp(OP_ADD, intValue(t, nrr), 1, &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nl);
+                            rewriteConst(t, k[0]);
+                            rewriteOp(t, OP_MUL);
+                            endRewrite(t);
+                            return 49;
+                        }
+                        break;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:80: x + x => x * 2
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    rewriteConst(t, 2);
+                    rewriteOp(t, OP_MUL);
+                    endRewrite(t);
+                    return 47;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:81: (x * c) + x => x * (c + 1)
+                    if (sameTree(t, nll, nr) && droppable(t, nll) && applyOp(OP_ADD, intValue(t, nlr), 1, &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 48;
+                    }
+                    break;
+                }
+                break;
+            }
+            break;
+        default:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:37: x + 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 12;
+                }
+                // rewrite.rules:80: x + x => x * 2
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    rewriteConst(t, 2);
+                    rewriteOp(t, OP_MUL);
+                    endRewrite(t);
+                    return 47;
+                }
+                break;
+            case OP_SUB:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                switch (nodeClass(t, nrl)) {
+                case CLASS_INT:
+                    // rewrite.rules:68: x + (0 - y) => x - y
+                    if (intValue(t, nrl) == 0) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteCopy(t, nrr);
+                        rewriteOp(t, OP_SUB);
+                        endRewrite(t);
+                        return 39;
+                    }
+                    // rewrite.rules:80: x + x => x * 2
+                    if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, 2);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 47;
+                    }
+                    break;
+                default:
+                    // rewrite.rules:80: x + x => x * 2
+                    if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, 2);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 47;
+                    }
+                    break;
+                }
+                break;
+            case OP_MUL:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:80: x + x => x * 2
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    rewriteConst(t, 2);
+                    rewriteOp(t, OP_MUL);
+                    endRewrite(t);
+                    return 47;
+                }
+                switch (nodeClass(t, nrr)) {
+                case CLASS_INT:
+                    // rewrite.rules:82: x + (x * c) => x * (c + 1)
+                    if (sameTree(t, nl, nrl) && droppable(t, nl) && applyOp(OP_ADD, intValue(t, nrr), 1, &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 49;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:80: x + x => x * 2
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    rewriteConst(t, 2);
+                    rewriteOp(t, OP_MUL);
+                    endRewrite(t);
+                    return 47;
+                }
+                break;
+            }
+            break;
+        }
+        break;
+    case OP_SUB:
+        nl = t->node[n].left;
+        nr = t->node[n].right;
+        switch (nodeClass(t, nl)) {
+        case CLASS_INT:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:22: c1 - c2 => c1 - c2
+                if (applyOp(OP_SUB, intValue(t, nl), intValue(t, nr), &k[0])) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, k[0]);
+                    endRewrite(t);
+                    return 1;
+                }
+                // rewrite.rules:38: x - 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 13;
+                }
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                break;
+            case OP_SUB:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                switch (nodeClass(t, nrl)) {
+                case CLASS_INT:
+                    // rewrite.rules:66: 0 - (0 - x) => x
+                    if (intValue(t, nl) == 0 && intValue(t, nrl) == 0) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nrr);
+                        endRewrite(t);
+                        return 37;
+                    }
+                    // rewrite.rules:67: x - (0 - y) => x + y
+                    if (intValue(t, nrl) == 0) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteCopy(t, nrr);
+                        rewriteOp(t, OP_ADD);
+                        endRewrite(t);
+                        return 38;
+                    }
+                    // rewrite.rules:75: x - (x - y) => y
+                    if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nrr);
+                        endRewrite(t);
+                        return 44;
+                    }
+                    break;
+                default:
+                    // rewrite.rules:75: x - (x - y) => y
+                    if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nrr);
+                        endRewrite(t);
+                        return 44;
+                    }
+                    break;
+                }
+                break;
+            case OP_ADD:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                // rewrite.rules:76: x - (x + y) => 0 - y
+                if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    rewriteCopy(t, nrr);
+                    rewriteOp(t, OP_SUB);
+                    endRewrite(t);
+                    return 45;
+                }
+                break;
+            default:
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                break;
+            }
+            break;
+        case OP_ADD:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:38: x - 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 13;
+                }
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:54: (x + c1) - c2 => x + (c1 - c2)
+                    if (applyOp(OP_SUB, intValue(t, nlr), intValue(t, nr), &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_ADD);
+                        endRewrite(t);
+                        return 27;
+                    }
+                    // rewrite.rules:72: (x + y) - y => x
+                    if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        endRewrite(t);
+                        return 41;
+                    }
+                    // rewrite.rules:77: (x + c) - x => c
+                    if (sameTree(t, nll, nr) && droppable(t, nll)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nlr);
+                        endRewrite(t);
+                        return 46;
+                    }
+                    break;
+                default:
+                    // rewrite.rules:72: (x + y) - y => x
+                    if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        endRewrite(t);
+                        return 41;
+                    }
+                    break;
+                }
+                break;
+            case OP_SUB:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                switch (nodeClass(t, nrl)) {
+                case CLASS_INT:
+                    // rewrite.rules:67: x - (0 - y) => x + y
+                    if (intValue(t, nrl) == 0) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteCopy(t, nrr);
+                        rewriteOp(t, OP_ADD);
+                        endRewrite(t);
+                        return 38;
+                    }
+                    // rewrite.rules:72: (x + y) - y => x
+                    if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        endRewrite(t);
+                        return 41;
+                    }
+                    // rewrite.rules:75: x - (x - y) => y
+                    if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nrr);
+                        endRewrite(t);
+                        return 44;
+                    }
+                    switch (nodeClass(t, nlr)) {
+                    case CLASS_INT:
+                        // rewrite.rules:77: (x + c) - x => c
+                        if (sameTree(t, nll, nr) && droppable(t, nll)) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nlr);
+                            endRewrite(t);
+                            return 46;
+                        }
+                        break;
+                    }
+                    break;
+                default:
+                    // rewrite.rules:72: (x + y) - y => x
+                    if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        endRewrite(t);
+                        return 41;
+                    }
+                    // rewrite.rules:75: x - (x - y) => y
+                    if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nrr);
+                        endRewrite(t);
+                        return 44;
+                    }
+                    switch (nodeClass(t, nlr)) {
+                    case CLASS_INT:
+                        // rewrite.rules:77: (x + c) - x => c
+                        if (sameTree(t, nll, nr) && droppable(t, nll)) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nlr);
+                            endRewrite(t);
+                            return 46;
+                        }
+                        break;
+                    }
+                    break;
+                }
+                break;
+            case OP_ADD:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                // rewrite.rules:72: (x + y) - y => x
+                if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nll);
+                    endRewrite(t);
+                    return 41;
+                }
+                // rewrite.rules:76: x - (x + y) => 0 - y
+                if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    rewriteCopy(t, nrr);
+                    rewriteOp(t, OP_SUB);
+                    endRewrite(t);
+                    return 45;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:77: (x + c) - x => c
+                    if (sameTree(t, nll, nr) && droppable(t, nll)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nlr);
+                        endRewrite(t);
+                        return 46;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                // rewrite.rules:72: (x + y) - y => x
+                if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nll);
+                    endRewrite(t);
+                    return 41;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:77: (x + c) - x => c
+                    if (sameTree(t, nll, nr) && droppable(t, nll)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nlr);
+                        endRewrite(t);
+                        return 46;
+                    }
+                    break;
+                }
+                break;
+            }
+            break;
+        case OP_SUB:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:38: x - 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 13;
+                }
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:56: (x - c1) - c2 => x - (c1 + c2)
+                    if (applyOp(OP_ADD, intValue(t, nlr), intValue(t, nr), &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_SUB);
+                        endRewrite(t);
+                        return 29;
+                    }
+                    switch (nodeClass(t, nll)) {
+                    case CLASS_INT:
+                        // rewrite.rules:58: (c1 - x) - c2 => (c1 - c2) - x
+                        if (applyOp(OP_SUB, intValue(t, nll), intValue(t, nr), &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteConst(t, k[0]);
+                            rewriteCopy(t, nlr);
+                            rewriteOp(t, OP_SUB);
+                            endRewrite(t);
+                            return 31;
+                        }
+                        break;
+                    }
+                    break;
+                default:
+                    switch (nodeClass(t, nll)) {
+                    case CLASS_INT:
+                        // rewrite.rules:58: (c1 - x) - c2 => (c1 - c2) - x
+                        if (applyOp(OP_SUB, intValue(t, nll), intValue(t, nr), &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteConst(t, k[0]);
+                            rewriteCopy(t, nlr);
+                            rewriteOp(t, OP_SUB);
+                            endRewrite(t);
+                            return 31;
+                        }
+                        break;
+                    }
+                    break;
+                }
+                break;
+            case OP_SUB:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                switch (nodeClass(t, nrl)) {
+                case CLASS_INT:
+                    // rewrite.rules:67: x - (0 - y) => x + y
+                    if (intValue(t, nrl) == 0) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteCopy(t, nrr);
+                        rewriteOp(t, OP_ADD);
+                        endRewrite(t);
+                        return 38;
+                    }
+                    // rewrite.rules:75: x - (x - y) => y
+                    if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nrr);
+                        endRewrite(t);
+                        return 44;
+                    }
+                    break;
+                default:
+                    // rewrite.rules:75: x - (x - y) => y
+                    if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nrr);
+                        endRewrite(t);
+                        return 44;
+                    }
+                    break;
+                }
+                break;
+            case OP_ADD:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                // rewrite.rules:76: x - (x + y) => 0 - y
+                if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    rewriteCopy(t, nrr);
+                    rewriteOp(t, OP_SUB);
+                    endRewrite(t);
+                    return 45;
+                }
+                break;
+            default:
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                break;
+            }
+            break;
+        case OP_MUL:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:38: x - 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 13;
+                }
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:83: (x * c) - x => x * (c - 1)
+                    if (sameTree(t, nll, nr) && droppable(t, nll) && applyOp(OP_SUB, intValue(t, nlr), 1, &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 50;
+                    }
+                    break;
+                }
+                break;
+            case OP_SUB:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                switch (nodeClass(t, nrl)) {
+                case CLASS_INT:
+                    // rewrite.rules:67: x - (0 - y) => x + y
+                    if (intValue(t, nrl) == 0) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteCopy(t, nrr);
+                        rewriteOp(t, OP_ADD);
+                        endRewrite(t);
+                        return 38;
+                    }
+                    // rewrite.rules:75: x - (x - y) => y
+                    if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nrr);
+                        endRewrite(t);
+                        return 44;
+                    }
+                    switch (nodeClass(t, nlr)) {
+                    case CLASS_INT:
+                        // rewrite.rules:83: (x * c) - x => x * (c - 1)
+                        if (sameTree(t, nll, nr) && droppable(t, nll) && applyOp(OP_SUB, intValue(t, nlr), 1, &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            rewriteConst(t, k[0]);
+                            rewriteOp(t, OP_MUL);
+                            endRewrite(t);
+                            return 50;
+                        }
+                        break;
+                    }
+                    break;
+                default:
+                    // rewrite.rules:75: x - (x - y) => y
+                    if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nrr);
+                        endRewrite(t);
+                        return 44;
+                    }
+                    switch (nodeClass(t, nlr)) {
+                    case CLASS_INT:
+                        // rewrite.rules:83: (x * c) - x => x * (c - 1)
+                        if (sameTree(t, nll, nr) && droppable(t, nll) && applyOp(OP_SUB, intValue(t, nlr), 1, &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            rewriteConst(t, k[0]);
+                            rewriteOp(t, OP_MUL);
+                            endRewrite(t);
+                            return 50;
+                        }
+                        break;
+                    }
+                    break;
+                }
+                break;
+            case OP_ADD:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                // rewrite.rules:76: x - (x + y) => 0 - y
+                if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    rewriteCopy(t, nrr);
+                    rewriteOp(t, OP_SUB);
+                    endRewrite(t);
+                    return 45;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:83: (x * c) - x => x * (c - 1)
+                    if (sameTree(t, nll, nr) && droppable(t, nll) && applyOp(OP_SUB, intValue(t, nlr), 1, &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 50;
+                    }
+                    break;
+                }
+                break;
+            case OP_MUL:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:83: (x * c) - x => x * (c - 1)
+                    if (sameTree(t, nll, nr) && droppable(t, nll) && applyOp(OP_SUB, intValue(t, nlr), 1, &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 50;
+                    }
+                    switch (nodeClass(t, nrr)) {
+                    case CLASS_INT:
+                        // rewrite.rules:85: (x * c1) - (x * c2) => x * (c1 - c2)
+                        if (sameTree(t, nll, nrl) && droppable(t, nll) && applyOp(OP_SUB, intValue(t, nlr), intValue(t, nrr), &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            rewriteConst(t, k[0]);
+                            rewriteOp(t, OP_MUL);
+                            endRewrite(t);
+                            return 52;
+                        }
+                        break;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:83: (x * c) - x => x * (c - 1)
+                    if (sameTree(t, nll, nr) && droppable(t, nll) && applyOp(OP_SUB, intValue(t, nlr), 1, &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 50;
+                    }
+                    break;
+                }
+                break;
+            }
+            break;
+        default:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:38: x - 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 13;
+                }
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                break;
+            case OP_SUB:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                switch (nodeClass(t, nrl)) {
+                case CLASS_INT:
+                    // rewrite.rules:67: x - (0 - y) => x + y
+                    if (intValue(t, nrl) == 0) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nl);
+                        rewriteCopy(t, nrr);
+                        rewriteOp(t, OP_ADD);
+                        endRewrite(t);
+                        return 38;
+                    }
+                    // rewrite.rules:75: x - (x - y) => y
+                    if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nrr);
+                        endRewrite(t);
+                        return 44;
+                    }
+                    break;
+                default:
+                    // rewrite.rules:75: x - (x - y) => y
+                    if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nrr);
+                        endRewrite(t);
+                        return 44;
+                    }
+                    break;
+                }
+                break;
+            case OP_ADD:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                // rewrite.rules:76: x - (x + y) => 0 - y
+                if (sameTree(t, nl, nrl) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    rewriteCopy(t, nrr);
+                    rewriteOp(t, OP_SUB);
+                    endRewrite(t);
+                    return 45;
+                }
+                break;
+            default:
+                // rewrite.rules:47: x - x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 22;
+                }
+                break;
+            }
+            break;
+        }
+        break;
+    case OP_MUL:
+        nl = t->node[n].left;
+        nr = t->node[n].right;
+        switch (nodeClass(t, nl)) {
+        case CLASS_INT:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:23: c1 * c2 => c1 * c2
+                if (applyOp(OP_MUL, intValue(t, nl), intValue(t, nr), &k[0])) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, k[0]);
+                    endRewrite(t);
+                    return 2;
+                }
+                // rewrite.rules:31: c * x => x * c
+                beginRewrite(t, n);
+                rewriteCopy(t, nr);
+                rewriteCopy(t, nl);
+                rewriteOp(t, OP_MUL);
+                endRewrite(t);
+                return 8;
+            default:
+                // rewrite.rules:31: c * x => x * c
+                beginRewrite(t, n);
+                rewriteCopy(t, nr);
+                rewriteCopy(t, nl);
+                rewriteOp(t, OP_MUL);
+                endRewrite(t);
+                return 8;
+            }
+            break;
+        case OP_MUL:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:39: x * 1 => x
+                if (intValue(t, nr) == 1) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 14;
+                }
+                // rewrite.rules:40: x * 0 => 0
+                if (intValue(t, nr) == 0 && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 15;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:59: (x * c1) * c2 => x * (c1 * c2)
+                    if (applyOp(OP_MUL, intValue(t, nlr), intValue(t, nr), &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 32;
+                    }
+                    break;
+                }
+                break;
+            }
+            break;
+        case OP_SUB:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:39: x * 1 => x
+                if (intValue(t, nr) == 1) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 14;
+                }
+                // rewrite.rules:40: x * 0 => 0
+                if (intValue(t, nr) == 0 && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 15;
+                }
+                switch (nodeClass(t, nll)) {
+                case CLASS_INT:
+                    // rewrite.rules:69: (0 - x) * c => x * (0 - c)
+                    if (intValue(t, nll) == 0 && applyOp(OP_SUB, 0, intValue(t, nr), &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nlr);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_MUL);
+                        endRewrite(t);
+                        return 40;
+                    }
+                    break;
+                }
+                break;
+            }
+            break;
+        default:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:39: x * 1 => x
+                if (intValue(t, nr) == 1) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 14;
+                }
+                // rewrite.rules:40: x * 0 => 0
+                if (intValue(t, nr) == 0 && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 15;
+                }
+                break;
+            }
+            break;
+        }
+        break;
+    case OP_DIV:
+        nl = t->node[n].left;
+        nr = t->node[n].right;
+        switch (nodeClass(t, nl)) {
+        case CLASS_INT:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:24: c1 / c2 => c1 / c2
+                if (applyOp(OP_DIV, intValue(t, nl), intValue(t, nr), &k[0])) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, k[0]);
+                    endRewrite(t);
+                    return 3;
+                }
+                // rewrite.rules:41: x / 1 => x
+                if (intValue(t, nr) == 1) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 16;
+                }
+                break;
+            }
+            break;
+        case OP_DIV:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:41: x / 1 => x
+                if (intValue(t, nr) == 1) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 16;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:63: (x / c1) / c2 => x / (c1 * c2) if c1 > 0 && c2 > 0 && c1 * c2 <= 2147483647
+                    if (((long long)intValue(t, nlr) > 0 && (long long)intValue(t, nr) > 0 && (long long)intValue(t, nlr) * (long long)intValue(t, nr) <= 2147483647) && applyOp(OP_MUL, intValue(t, nlr), intValue(t, nr), &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_DIV);
+                        endRewrite(t);
+                        return 36;
+                    }
+                    break;
+                }
+                break;
+            }
+            break;
+        default:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:41: x / 1 => x
+                if (intValue(t, nr) == 1) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 16;
+                }
+                break;
+            }
+            break;
+        }
+        break;
+    case OP_AND:
+        nl = t->node[n].left;
+        nr = t->node[n].right;
+        switch (nodeClass(t, nl)) {
+        case CLASS_INT:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:25: c1 & c2 => c1 & c2
+                if (applyOp(OP_AND, intValue(t, nl), intValue(t, nr), &k[0])) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, k[0]);
+                    endRewrite(t);
+                    return 4;
+                }
+                // rewrite.rules:32: c & x => x & c
+                beginRewrite(t, n);
+                rewriteCopy(t, nr);
+                rewriteCopy(t, nl);
+                rewriteOp(t, OP_AND);
+                endRewrite(t);
+                return 9;
+            default:
+                // rewrite.rules:32: c & x => x & c
+                beginRewrite(t, n);
+                rewriteCopy(t, nr);
+                rewriteCopy(t, nl);
+                rewriteOp(t, OP_AND);
+                endRewrite(t);
+                return 9;
+            }
+            break;
+        case OP_AND:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:42: x & 0 => 0
+                if (intValue(t, nr) == 0 && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 17;
+                }
+                // rewrite.rules:43: x & -1 => x
+                if (intValue(t, nr) == -1) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 18;
+                }
+                // rewrite.rules:49: x & x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 24;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:60: (x & c1) & c2 => x & (c1 & c2)
+                    if (applyOp(OP_AND, intValue(t, nlr), intValue(t, nr), &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_AND);
+                        endRewrite(t);
+                        return 33;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:49: x & x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 24;
+                }
+                break;
+            }
+            break;
+        case OP_OR:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:42: x & 0 => 0
+                if (intValue(t, nr) == 0 && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 17;
+                }
+                // rewrite.rules:43: x & -1 => x
+                if (intValue(t, nr) == -1) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 18;
+                }
+                // rewrite.rules:49: x & x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 24;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:91: (x | c1) & c2 => x & c2 if (c1 & c2) == 0
+                    if ((((long long)intValue(t, nlr) & (long long)intValue(t, nr)) == 0)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteCopy(t, nr);
+                        rewriteOp(t, OP_AND);
+                        endRewrite(t);
+                        return 56;
+                    }
+                    break;
+                }
+                break;
+            case OP_OR:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:49: x & x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 24;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    switch (nodeClass(t, nrr)) {
+                    case CLASS_INT:
+                        // rewrite.rules:88: (x | c1) & (x | c2) => x | (c1 & c2)
+                        if (sameTree(t, nll, nrl) && droppable(t, nll) && applyOp(OP_AND, intValue(t, nlr), intValue(t, nrr), &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            rewriteConst(t, k[0]);
+                            rewriteOp(t, OP_OR);
+                            endRewrite(t);
+                            return 55;
+                        }
+                        break;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:49: x & x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 24;
+                }
+                break;
+            }
+            break;
+        case OP_XOR:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:42: x & 0 => 0
+                if (intValue(t, nr) == 0 && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 17;
+                }
+                // rewrite.rules:43: x & -1 => x
+                if (intValue(t, nr) == -1) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 18;
+                }
+                // rewrite.rules:49: x & x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 24;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:92: (x ^ c1) & c2 => x & c2 if (c1 & c2) == 0
+                    if ((((long long)intValue(t, nlr) & (long long)intValue(t, nr)) == 0)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteCopy(t, nr);
+                        rewriteOp(t, OP_AND);
+                        endRewrite(t);
+                        return 57;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:49: x & x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 24;
+                }
+                break;
+            }
+            break;
+        case OP_MUL:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:42: x & 0 => 0
+                if (intValue(t, nr) == 0 && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 17;
+                }
+                // rewrite.rules:43: x & -1 => x
+                if (intValue(t, nr) == -1) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 18;
+                }
+                // rewrite.rules:49: x & x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 24;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:94: (x * c1) & c2 => 0 if pow2(c1) && (c2 & -c1) == 0
+                    if (droppable(t, nll) && (pow2((long long)intValue(t, nlr)) && ((long long)intValue(t, nr) & -(long long)intValue(t, nlr)) == 0)) {
+                        beginRewrite(t, n);
+                        rewriteConst(t, 0);
+                        endRewrite(t);
+                        return 59;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:49: x & x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 24;
+                }
+                break;
+            }
+            break;
+        default:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:42: x & 0 => 0
+                if (intValue(t, nr) == 0 && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 17;
+                }
+                // rewrite.rules:43: x & -1 => x
+                if (intValue(t, nr) == -1) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 18;
+                }
+                // rewrite.rules:49: x & x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 24;
+                }
+                break;
+            default:
+                // rewrite.rules:49: x & x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 24;
+                }
+                break;
+            }
+            break;
+        }
+        break;
+    case OP_OR:
+        nl = t->node[n].left;
+        nr = t->node[n].right;
+        switch (nodeClass(t, nl)) {
+        case CLASS_INT:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:26: c1 | c2 => c1 | c2
+                if (applyOp(OP_OR, intValue(t, nl), intValue(t, nr), &k[0])) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, k[0]);
+                    endRewrite(t);
+                    return 5;
+                }
+                // rewrite.rules:33: c | x => x | c
+                beginRewrite(t, n);
+                rewriteCopy(t, nr);
+                rewriteCopy(t, nl);
+                rewriteOp(t, OP_OR);
+                endRewrite(t);
+                return 10;
+            default:
+                // rewrite.rules:33: c | x => x | c
+                beginRewrite(t, n);
+                rewriteCopy(t, nr);
+                rewriteCopy(t, nl);
+                rewriteOp(t, OP_OR);
+                endRewrite(t);
+                return 10;
+            }
+            break;
+        case OP_OR:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:44: x | 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 19;
+                }
+                // rewrite.rules:45: x | -1 => -1
+                if (intValue(t, nr) == -1 && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, -1);
+                    endRewrite(t);
+                    return 20;
+                }
+                // rewrite.rules:50: x | x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 25;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:61: (x | c1) | c2 => x | (c1 | c2)
+                    if (applyOp(OP_OR, intValue(t, nlr), intValue(t, nr), &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_OR);
+                        endRewrite(t);
+                        return 34;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:50: x | x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 25;
+                }
+                break;
+            }
+            break;
+        case OP_AND:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:44: x | 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 19;
+                }
+                // rewrite.rules:45: x | -1 => -1
+                if (intValue(t, nr) == -1 && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, -1);
+                    endRewrite(t);
+                    return 20;
+                }
+                // rewrite.rules:50: x | x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 25;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:93: (x & c1) | c2 => x | c2 if (c1 | c2) == -1
+                    if ((((long long)intValue(t, nlr) | (long long)intValue(t, nr)) == -1)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteCopy(t, nr);
+                        rewriteOp(t, OP_OR);
+                        endRewrite(t);
+                        return 58;
+                    }
+                    break;
+                }
+                break;
+            case OP_AND:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:50: x | x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 25;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    switch (nodeClass(t, nrr)) {
+                    case CLASS_INT:
+                        // rewrite.rules:86: (x & c1) | (x & c2) => x & (c1 | c2)
+                        if (sameTree(t, nll, nrl) && droppable(t, nll) && applyOp(OP_OR, intValue(t, nlr), intValue(t, nrr), &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            rewriteConst(t, k[0]);
+                            rewriteOp(t, OP_AND);
+                            endRewrite(t);
+                            return 53;
+                        }
+                        break;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:50: x | x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 25;
+                }
+                break;
+            }
+            break;
+        default:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:44: x | 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 19;
+                }
+                // rewrite.rules:45: x | -1 => -1
+                if (intValue(t, nr) == -1 && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, -1);
+                    endRewrite(t);
+                    return 20;
+                }
+                // rewrite.rules:50: x | x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 25;
+                }
+                break;
+            default:
+                // rewrite.rules:50: x | x => x
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 25;
+                }
+                break;
+            }
+            break;
+        }
+        break;
+    case OP_XOR:
+        nl = t->node[n].left;
+        nr = t->node[n].right;
+        switch (nodeClass(t, nl)) {
+        case CLASS_INT:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:27: c1 ^ c2 => c1 ^ c2
+                if (applyOp(OP_XOR, intValue(t, nl), intValue(t, nr), &k[0])) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, k[0]);
+                    endRewrite(t);
+                    return 6;
+                }
+                // rewrite.rules:34: c ^ x => x ^ c
+                beginRewrite(t, n);
+                rewriteCopy(t, nr);
+                rewriteCopy(t, nl);
+                rewriteOp(t, OP_XOR);
+                endRewrite(t);
+                return 11;
+            default:
+                // rewrite.rules:34: c ^ x => x ^ c
+                beginRewrite(t, n);
+                rewriteCopy(t, nr);
+                rewriteCopy(t, nl);
+                rewriteOp(t, OP_XOR);
+                endRewrite(t);
+                return 11;
+            }
+            break;
+        case OP_XOR:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:46: x ^ 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 21;
+                }
+                // rewrite.rules:48: x ^ x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 23;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    // rewrite.rules:62: (x ^ c1) ^ c2 => x ^ (c1 ^ c2)
+                    if (applyOp(OP_XOR, intValue(t, nlr), intValue(t, nr), &k[0])) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        rewriteConst(t, k[0]);
+                        rewriteOp(t, OP_XOR);
+                        endRewrite(t);
+                        return 35;
+                    }
+                    // rewrite.rules:74: (x ^ y) ^ y => x
+                    if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        endRewrite(t);
+                        return 43;
+                    }
+                    break;
+                default:
+                    // rewrite.rules:74: (x ^ y) ^ y => x
+                    if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                        beginRewrite(t, n);
+                        rewriteCopy(t, nll);
+                        endRewrite(t);
+                        return 43;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:48: x ^ x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 23;
+                }
+                // rewrite.rules:74: (x ^ y) ^ y => x
+                if (sameTree(t, nlr, nr) && droppable(t, nlr)) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nll);
+                    endRewrite(t);
+                    return 43;
+                }
+                break;
+            }
+            break;
+        case OP_AND:
+            nll = t->node[nl].left;
+            nlr = t->node[nl].right;
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:46: x ^ 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 21;
+                }
+                // rewrite.rules:48: x ^ x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 23;
+                }
+                break;
+            case OP_AND:
+                nrl = t->node[nr].left;
+                nrr = t->node[nr].right;
+                // rewrite.rules:48: x ^ x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 23;
+                }
+                switch (nodeClass(t, nlr)) {
+                case CLASS_INT:
+                    switch (nodeClass(t, nrr)) {
+                    case CLASS_INT:
+                        // rewrite.rules:87: (x & c1) ^ (x & c2) => x & (c1 ^ c2)
+                        if (sameTree(t, nll, nrl) && droppable(t, nll) && applyOp(OP_XOR, intValue(t, nlr), intValue(t, nrr), &k[0])) {
+                            beginRewrite(t, n);
+                            rewriteCopy(t, nll);
+                            rewriteConst(t, k[0]);
+                            rewriteOp(t, OP_AND);
+                            endRewrite(t);
+                            return 54;
+                        }
+                        break;
+                    }
+                    break;
+                }
+                break;
+            default:
+                // rewrite.rules:48: x ^ x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 23;
+                }
+                break;
+            }
+            break;
+        default:
+            switch (nodeClass(t, nr)) {
+            case CLASS_INT:
+                // rewrite.rules:46: x ^ 0 => x
+                if (intValue(t, nr) == 0) {
+                    beginRewrite(t, n);
+                    rewriteCopy(t, nl);
+                    endRewrite(t);
+                    return 21;
+                }
+                // rewrite.rules:48: x ^ x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 23;
+                }
+                break;
+            default:
+                // rewrite.rules:48: x ^ x => 0
+                if (sameTree(t, nl, nr) && droppable(t, nl)) {
+                    beginRewrite(t, n);
+                    rewriteConst(t, 0);
+                    endRewrite(t);
+                    return 23;
+                }
+                break;
+            }
+            break;
+        }
+        break;
+    }
+    return -1;
+}
@@ -0,0 +1,595 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+
+// Compile the rules of the rewrite pass into a decision tree in C:
+//
+//     ./rulegen rewrite.rules > rewriteMatch.c
+//
+// See rewrite.rules for the language of the rules.
+
+#define MAXRULES 256
+#define MAXNODES 64     // of the pattern and the replacement of a rule
+#define MAXCAPS 8
+#define MAXDEPTH 4      // below the root of a pattern or a replacement
+#define MAXLINE 512
+#define CLASS_INT 7     // the classes of a node are the operators and INT
+
+typedef enum {
+    PAT_OP, PAT_ANY, PAT_CONST, PAT_LIT
+} PatKind;
+
+typedef struct {
+    PatKind kind;
+    int op;             // index in opChar
+    int cap;            // capture of PAT_ANY and PAT_CONST
+    int val;            // value of PAT_LIT
+    int left, right;
+} PatNode;
+
+typedef struct {
+    int line;
+    char text[MAXLINE];
+    PatNode node[MAXNODES];
+    int nnode;
+    int pattern, replace;
+    char cond[4 * MAXLINE];             // in C, empty for none
+    int ncap;
+    char capName[MAXCAPS][16];
+    int capConst[MAXCAPS];
+    int capUses[MAXCAPS];               // in the pattern
+    int capKept[MAXCAPS];               // in the replacement
+    char capPath[MAXCAPS][MAXDEPTH + 1];    // of its first use
+} Rule;
+
+static const char opChar[] = "+-*/&|^";
+static const char *opName[] = { "OP_ADD", "OP_SUB", "OP_MUL", "OP_DIV", "OP_AND", "OP_OR", "OP_XOR" };
+static const char *levelOps[] = { "|", "^", "&", "+-", "*/" };
+
+static Rule rules[MAXRULES];
+static int nrules = 0;
+static const char *fileName;
+static Rule *rule;              // being parsed
+static const char *p;
+static int inPattern;
+
+static void fail(const char *fmt, ...) {
+    va_list ap;
+
+    fprintf(stderr, "%s:%d: ", fileName, rule->line);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+static void skipBlanks(void) {
+    while (*p == ' ' || *p == '\t') p++;
+}
+
+static int newNode(PatKind kind, int op, int left, int right) {
+    PatNode *node;
+
+    if (rule->nnode == MAXNODES) fail("rule too large");
+    node = &rule->node[rule->nnode];
+    node->kind = kind;
+    node->op = op;
+    node->cap = node->val = 0;
+    node->left = left;
+    node->right = right;
+    return rule->nnode++;
+}
+
+// Index of a capture, added if new in the pattern
+static int capture(const char *name) {
+    int i;
+
+    for (i = 0; i < rule->ncap && strcmp(rule->capName[i], name) != 0; i++);
+    if (i < rule->ncap) return i;
+    if (!inPattern) fail("%s is not in the pattern", name);
+    if (i == MAXCAPS) fail("too many names");
+    strcpy(rule->capName[i], name);
+    // c, c1, c2 ... are constants
+    rule->capConst[i] = name[0] == 'c' && strspn(name + 1, "0123456789") == strlen(name + 1);
+    rule->ncap++;
+    return i;
+}
+
+static int parseExpr(int level);
+
+static int parsePrimary(void) {
+    char name[16];
+    long long v;
+    char *end;
+    int i = 0, n;
+
+    skipBlanks();
+    if (*p == '(') {
+        p++;
+        n = parseExpr(0);
+        skipBlanks();
+        if (*p++ != ')') fail("missing )");
+        return n;
+    }
+    if (isdigit((unsigned char)*p) || (*p == '-' && isdigit((unsigned char)p[1]))) {
+        v = strtoll(p, &end, 10);
+        if (v < -2147483647LL - 1 || v > 2147483647LL) fail("%lld is out of range", v);
+        p = end;
+        n = newNode(PAT_LIT, 0, -1, -1);
+        rule->node[n].val = (int)v;
+        return n;
+    }
+    if (!islower((unsigned char)*p)) fail("expected an operand at \"%s\"", p);
+    while (isalnum((unsigned char)*p)) {
+        if (i == (int)sizeof(name) - 1) fail("name too long");
+        name[i++] = *p++;
+    }
+    name[i] = '\0';
+    i = capture(name);
+    n = newNode(rule->capConst[i] ? PAT_CONST : PAT_ANY, 0, -1, -1);
+    rule->node[n].cap = i;
+    return n;
+}
+
+// The precedence of the language, | lowest
+static int parseExpr(int level) {
+    int left = level == 4 ? parsePrimary() : parseExpr(level + 1), right;
+    char op;
+
+    while (1) {
+        skipBlanks();
+        op = *p;
+        if (op == '\0' || strchr(levelOps[level], op) == NULL) return left;
+        p++;
+        right = level == 4 ? parsePrimary() : parseExpr(level + 1);
+        left = newNode(PAT_OP, (int)(strchr(opChar, op) - opChar), left, right);
+    }
+}
+
+static int depthOf(int n) {
+    const PatNode *node = &rule->node[n];
+    int l, r;
+
+    if (node->kind != PAT_OP) return 0;
+    l = depthOf(node->left);
+    r = depthOf(node->right);
+    return 1 + (l > r ? l : r);
+}
+
+// Record the uses of the captures of the pattern below path
+static void walkPattern(int n, char *path, int len) {
+    const PatNode *node = &rule->node[n];
+
+    path[len] = '\0';
+    if (node->kind == PAT_OP) {
+        path[len] = 'l';
+        walkPattern(node->left, path, len + 1);
+        path[len] = 'r';
+        walkPattern(node->right, path, len + 1);
+        path[len] = '\0';
+    } else if (node->kind != PAT_LIT) {
+        if (rule->capUses[node->cap]++ == 0) strcpy(rule->capPath[node->cap], path);
+    }
+}
+
+// The subtree captures in postfix order, the order they are evaluated in
+static int evalOrder(int n, int *order, int k) {
+    const PatNode *node = &rule->node[n];
+
+    if (node->kind == PAT_OP) {
+        k = evalOrder(node->left, order, k);
+        return evalOrder(node->right, order, k);
+    }
+    if (node->kind == PAT_ANY) order[k++] = node->cap;
+    return k;
+}
+
+// Keeping one copy of a repeated subtree is only right if nothing that
+// may change it runs between the copies, and a replacement must not
+// reorder or duplicate the subtrees it keeps
+static void checkOrder(void) {
+    int pat[MAXNODES], rep[MAXNODES], np, nr, i, j, last = -1, pos;
+
+    np = evalOrder(rule->pattern, pat, 0);
+    nr = evalOrder(rule->replace, rep, 0);
+    for (i = 0; i < np; i++) {
+        for (j = i + 1; j < np && pat[j] != pat[i]; j++);
+        if (j < np && j > i + 1)
+            fail("%s is evaluated between the copies of %s", rule->capName[pat[i + 1]], rule->capName[pat[i]]);
+    }
+    for (i = 0; i < nr; i++) {
+        if (rule->capKept[rep[i]]++ > 0) fail("%s is evaluated twice", rule->capName[rep[i]]);
+        for (pos = 0; pat[pos] != rep[i]; pos++);
+        if (pos < last) fail("%s is evaluated before %s", rule->capName[rep[i]], rule->capName[pat[last]]);
+        last = pos;
+    }
+}
+
+// The condition in C, the constants read from the tree
+static void parseCond(void) {
+    char name[16], *out = rule->cond;
+    int i;
+
+    while (*p && *p != '#' && *p != '\n' && *p != '\r') {
+        if (isalpha((unsigned char)*p)) {
+            for (i = 0; isalnum((unsigned char)*p); p++)
+                if (i < (int)sizeof(name) - 1) name[i++] = *p;
+            name[i] = '\0';
+            if (strcmp(name, "pow2") == 0) {
+                out += sprintf(out, "pow2");
+                continue;
+            }
+            for (i = 0; i < rule->ncap && strcmp(rule->capName[i], name) != 0; i++);
+            if (i == rule->ncap || !rule->capConst[i]) fail("%s is not a constant of the pattern", name);
+            out += sprintf(out, "(long long)intValue(t, n%s)", rule->capPath[i]);
+        } else if (isdigit((unsigned char)*p) || strchr("+-*/%&|^!~<>=() \t", *p)) {
+            *out++ = *p++;
+        } else {
+            fail("unexpected %c in the condition", *p);
+        }
+    }
+    while (out > rule->cond && (out[-1] == ' ' || out[-1] == '\t')) out--;
+    *out = '\0';
+}
+
+static void parseRule(char *line, int lineNo) {
+    char path[MAXDEPTH + 2];
+    size_t len = strcspn(line, "#\r\n");
+
+    while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t')) len--;
+    line[len] = '\0';
+    p = line;
+    skipBlanks();
+    if (*p == '\0') return;
+    if (nrules == MAXRULES) {
+        fprintf(stderr, "%s:%d: too many rules\n", fileName, lineNo);
+        exit(1);
+    }
+    rule = &rules[nrules];
+    rule->line = lineNo;
+    strcpy(rule->text, p);
+
+    inPattern = 1;
+    rule->pattern = parseExpr(0);
+    skipBlanks();
+    if (p[0] != '=' || p[1] != '>') fail("expected =>");
+    if (rule->node[rule->pattern].kind != PAT_OP) fail("a pattern must be an operator");
+    if (depthOf(rule->pattern) > MAXDEPTH) fail("pattern too deep");
+    walkPattern(rule->pattern, path, 0);
+    p += 2;
+    inPattern = 0;
+    rule->replace = parseExpr(0);
+    skipBlanks();
+    if (strncmp(p, "if", 2) == 0 && !isalnum((unsigned char)p[2])) {
+        p += 2;
+        skipBlanks();
+        parseCond();
+    } else if (*p != '\0') {
+        fail("unexpected \"%s\"", p);
+    }
+
+    if (depthOf(rule->replace) > MAXDEPTH) fail("replacement too deep");
+    checkOrder();
+    nrules++;
+}
+
+// Node of the pattern of r at path, -1 if the pattern does not reach it
+static int patternAt(const Rule *r, const char *path) {
+    int n = r->pattern;
+
+    for (; *path; path++) {
+        if (r->node[n].kind != PAT_OP) return -1;
+        n = *path == 'l' ? r->node[n].left : r->node[n].right;
+    }
+    return n;
+}
+
+// Class r needs at path, -1 for any
+static int classAt(const Rule *r, const char *path) {
+    int n = patternAt(r, path);
+
+    if (n < 0 || r->node[n].kind == PAT_ANY) return -1;
+    return r->node[n].kind == PAT_OP ? r->node[n].op : CLASS_INT;
+}
+
+
+static char body[64 * MAXLINE];        // the calls of a leaf, built before its condition
+static int bodyLen;
+
+static void out(const char *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    bodyLen += vsnprintf(body + bodyLen, sizeof(body) - bodyLen, fmt, ap);
+    va_end(ap);
+}
+
+static void indent(int depth) {
+    out("%*s", 4 * depth, "");
+}
+
+static void flush(void) {
+    fputs(body, stdout);
+    bodyLen = 0;
+    body[0] = '\0';
+}
+
+static void addCond(char *cond, const char *fmt, ...) {
+    va_list ap;
+
+    if (cond[0]) strcat(cond, " && ");
+    va_start(ap, fmt);
+    vsprintf(cond + strlen(cond), fmt, ap);
+    va_end(ap);
+}
+
+static int nfold, maxFold = 0;
+
+// C expression of the value of a subtree over constants; the folds it
+// needs go to the condition
+static void foldValue(const Rule *r, int n, char *value, char *cond) {
+    const PatNode *node = &r->node[n];
+    char left[32], right[32];
+
+    switch (node->kind) {
+    case PAT_CONST:
+        sprintf(value, "intValue(t, n%s)", r->capPath[node->cap]);
+        break;
+    case PAT_LIT:
+        sprintf(value, "%d", node->val);
+        break;
+    default:
+        foldValue(r, node->left, left, cond);
+        foldValue(r, node->right, right, cond);
+        addCond(cond, "applyOp(%s, %s, %s, &k[%d])", opName[node->op], left, right, nfold);
+        sprintf(value, "k[%d]", nfold++);
+        break;
+    }
+}
+
+static int constantOnly(const Rule *r, int n) {
+    const PatNode *node = &r->node[n];
+
+    if (node->kind == PAT_OP) return constantOnly(r, node->left) && constantOnly(r, node->right);
+    return node->kind != PAT_ANY;
+}
+
+// Operators over constants only in the subtree n of the rule being
+// counted, each one a fold
+static int folds(int n) {
+    const PatNode *node = &rule->node[n];
+
+    if (node->kind != PAT_OP) return 0;
+    return folds(node->left) + folds(node->right) + constantOnly(rule, n);
+}
+
+// The calls building the replacement in postfix order
+static void build(const Rule *r, int n, char *cond, int depth) {
+    const PatNode *node = &r->node[n];
+    char value[32];
+
+    if (node->kind == PAT_OP && constantOnly(r, n)) {
+        foldValue(r, n, value, cond);
+        indent(depth);
+        out("rewriteConst(t, %s);\n", value);
+    } else if (node->kind == PAT_OP) {
+        build(r, node->left, cond, depth);
+        build(r, node->right, cond, depth);
+        indent(depth);
+        out("rewriteOp(t, %s);\n", opName[node->op]);
+    } else if (node->kind == PAT_LIT) {
+        indent(depth);
+        out("rewriteConst(t, %d);\n", node->val);
+    } else {
+        indent(depth);
+        out("rewriteCopy(t, n%s);\n", r->capPath[node->cap]);
+    }
+}
+
+// Literals and the further uses of the captures
+static void matchConds(const Rule *r, int n, char *path, int len, char *cond) {
+    const PatNode *node = &r->node[n];
+
+    path[len] = '\0';
+    switch (node->kind) {
+    case PAT_OP:
+        path[len] = 'l';
+        matchConds(r, node->left, path, len + 1, cond);
+        path[len] = 'r';
+        matchConds(r, node->right, path, len + 1, cond);
+        path[len] = '\0';
+        break;
+    case PAT_LIT:
+        addCond(cond, "intValue(t, n%s) == %d", path, node->val);
+        break;
+    default:
+        if (strcmp(path, r->capPath[node->cap]) == 0) break;
+        if (node->kind == PAT_CONST)
+            addCond(cond, "intValue(t, n%s) == intValue(t, n%s)", r->capPath[node->cap], path);
+        else
+            addCond(cond, "sameTree(t, n%s, n%s)", r->capPath[node->cap], path);
+        break;
+    }
+}
+
+// Rule i, all the classes it tests being known; return 0 if it fires
+// whatever the tree holds
+static int leaf(int i, int depth) {
+    const Rule *r = &rules[i];
+    char cond[8 * MAXLINE] = "", path[MAXDEPTH + 2];
+    int c, inner;
+
+    matchConds(r, r->pattern, path, 0, cond);
+    for (c = 0; c < r->ncap; c++)
+        if (!r->capConst[c] && r->capKept[c] < r->capUses[c])
+            addCond(cond, "droppable(t, n%s)", r->capPath[c]);
+    if (r->cond[0]) addCond(cond, "(%s)", r->cond);
+
+    // building adds the folds to the condition
+    nfold = 0;
+    indent(depth);
+    out("// %s:%d: %s\n", fileName, r->line, r->text);
+    flush();
+    inner = depth + 1;
+    out("%*sbeginRewrite(t, n);\n", 4 * inner, "");
+    build(r, r->replace, cond, inner);
+    out("%*sendRewrite(t);\n", 4 * inner, "");
+    out("%*sreturn %d;\n", 4 * inner, "", i);
+    if (cond[0]) {
+        printf("%*sif (%s) {\n", 4 * depth, "", cond);
+        flush();
+        printf("%*s}\n", 4 * depth, "");
+        return 1;
+    }
+    // no condition: the calls go at the level of the comment
+    bodyLen = 0;
+    body[0] = '\0';
+    inner = depth;
+    out("%*sbeginRewrite(t, n);\n", 4 * inner, "");
+    nfold = 0;
+    build(r, r->replace, cond, inner);
+    out("%*sendRewrite(t);\n", 4 * inner, "");
+    out("%*sreturn %d;\n", 4 * inner, "", i);
+    flush();
+    return 0;
+}
+
+static char tested[MAXNODES][MAXDEPTH + 2];
+static int ntested;
+
+// First path in prefix order at or below path where r tests the class
+// and it is not known yet; return 0 if there is none
+static int nextTest(const Rule *r, char *path) {
+    size_t len = strlen(path);
+    int n = patternAt(r, path), i;
+
+    if (n < 0 || r->node[n].kind == PAT_ANY) return 0;
+    for (i = 0; i < ntested && strcmp(tested[i], path) != 0; i++);
+    if (i == ntested) return 1;
+    if (r->node[n].kind != PAT_OP) return 0;
+    path[len] = 'l';
+    path[len + 1] = '\0';
+    if (nextTest(r, path)) return 1;
+    path[len] = 'r';
+    if (nextTest(r, path)) return 1;
+    path[len] = '\0';
+    return 0;
+}
+
+static const char *className(int c) {
+    return c == CLASS_INT ? "CLASS_INT" : opName[c];
+}
+
+// The decision tree for the rules in rule, in priority order: switch on
+// the class of the first node the first rule tests that is not known
+// yet, every case keeping the rules that agree with it. Return 1 if the
+// code always returns.
+static int decide(const int *rule, int n, int depth) {
+    char path[MAXDEPTH + 2] = "";
+    int cls[CLASS_INT + 1], ncls = 0, sub[MAXRULES], nsub, i, j, c, below;
+
+    while (n > 0) {
+        path[0] = '\0';
+        if (nextTest(&rules[rule[0]], path)) break;
+        if (!leaf(rule[0], depth)) return 1;
+        rule++;
+        n--;
+    }
+    if (n == 0) return 0;
+
+    for (i = 0; i < n; i++) {
+        c = classAt(&rules[rule[i]], path);
+        for (j = 0; j < ncls && cls[j] != c; j++);
+        if (c >= 0 && j == ncls) cls[ncls++] = c;
+    }
+    strcpy(tested[ntested++], path);
+    printf("%*sswitch (nodeClass(t, n%s)) {\n", 4 * depth, "", path);
+    for (j = 0; j <= ncls; j++) {
+        for (i = nsub = below = 0; i < n; i++) {
+            c = classAt(&rules[rule[i]], path);
+            if (c >= 0 && (j == ncls || c != cls[j])) continue;
+            sub[nsub++] = rule[i];
+            if (c >= 0 && c != CLASS_INT) below = 1;
+        }
+        if (nsub == 0) continue;
+        if (j < ncls) printf("%*scase %s:\n", 4 * depth, "", className(cls[j]));
+        else printf("%*sdefault:\n", 4 * depth, "");
+        if (below) {
+            printf("%*sn%sl = t->node[n%s].left;\n", 4 * depth + 4, "", path, path);
+            printf("%*sn%sr = t->node[n%s].right;\n", 4 * depth + 4, "", path, path);
+        }
+        if (!decide(sub, nsub, depth + 1)) printf("%*sbreak;\n", 4 * depth + 4, "");
+    }
+    printf("%*s}\n", 4 * depth, "");
+    ntested--;
+    return 0;
+}
+
+// The node variables of every path a pattern reaches below its root
+static void declare(char *path, int len, int *first) {
+    int i;
+
+    for (i = 0; i < nrules && patternAt(&rules[i], path) < 0; i++);
+    if (i == nrules) return;
+    if (len > 0) {
+        printf("%s n%s = -1", *first ? "    int" : ",", path);
+        *first = 0;
+    }
+    if (len == MAXDEPTH) return;
+    path[len] = 'l';
+    path[len + 1] = '\0';
+    declare(path, len + 1, first);
+    path[len] = 'r';
+    declare(path, len + 1, first);
+    path[len] = '\0';
+}
+
+int main(int argc, char **argv) {
+    char line[MAXLINE], path[MAXDEPTH + 2] = "";
+    int order[MAXRULES], lineNo = 0, i, first = 1;
+    FILE *fp;
+    const char *s;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: rulegen rules > matcher.c\n");
+        return 1;
+    }
+    fileName = argv[1];
+    if ((fp = fopen(fileName, "r")) == NULL) {
+        fprintf(stderr, "rulegen: cannot open %s\n", fileName);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) parseRule(line, ++lineNo);
+    fclose(fp);
+
+    printf("// Generated by rulegen from %s, do not edit\n", fileName);
+    printf("#include \"rewrite.h\"\n#include \"opt.h\"\n\n");
+    printf("const int nrewrites = %d;\n\n", nrules);
+    printf("const char *rewriteRule[] = {\n");
+    for (i = 0; i < nrules; i++) {
+        printf("    \"");
+        for (s = rules[i].text; *s; s++) printf(*s == '"' || *s == '\\' ? "\\%c" : "%c", *s);
+        printf("\",\n");
+    }
+    printf("};\n\nconst int rewriteLine[] = {");
+    for (i = 0; i < nrules; i++) printf("%s%d", i == 0 ? "\n    " : i % 16 ? ", " : ",\n    ", rules[i].line);
+    printf("\n};\n\nlong long rewriteFired[%d];\n\n", nrules > 0 ? nrules : 1);
+
+    printf("int matchRewrite(Tree *t, int n) {\n");
+    declare(path, 0, &first);
+    if (!first) printf(";\n");
+    for (i = 0; i < nrules; i++) order[i] = i;
+    for (i = 0; i < nrules; i++) {
+        rule = &rules[i];
+        if (folds(rule->replace) > maxFold) maxFold = folds(rule->replace);
+    }
+    if (maxFold > 0) printf("    int k[%d];\n", maxFold);
+    printf("\n");
+    decide(order, nrules, 1);
+    printf("    return -1;\n}\n");
+    return 0;
+}
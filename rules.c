@@ -0,0 +1,181 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rules.h"
+#include "codeGen.h"
+#include "isel.h"
+
+int nrules = 0;
+
+// Code of a shape, found by superopt
+typedef struct {
+    char shape[MAXSHAPE];
+    int isel;           // uses the forms of -fisel
+    int regs;
+    int n;
+    Instr code[RULELEN];
+} Rule;
+
+static Rule *rules = NULL;
+static unsigned long long key = 0;
+
+int exprShape(Tree *t, int i, char *shape, const char **names) {
+    int *order, n = prefixOrder(t, i, &order), len = 0, nvar = 0, nops = 0, j, k;
+    const char *lexe;
+
+    shape[0] = '\0';
+    for (k = 0; k < n; k++) {
+        lexe = nodeLexeme(t, order[k]);
+        switch (t->node[order[k]].data) {
+        case ID:
+            for (j = 0; j < nvar && strcmp(names[j], lexe) != 0; j++);
+            if (j == nvar) {
+                if (nvar == RULEVARS) return -1;
+                names[nvar++] = lexe;
+            }
+            len += snprintf(shape + len, MAXSHAPE - len, "%sv%d", len ? " " : "", j);
+            break;
+        case ADDSUB:
+        case MULDIV:
+        case AND:
+        case OR:
+        case XOR:
+            if (++nops > RULEOPS) return -1;
+            // fall through
+        case INT:
+            len += snprintf(shape + len, MAXSHAPE - len, "%s%s", len ? " " : "", lexe);
+            break;
+        default:
+            return -1;
+        }
+        if (len >= MAXSHAPE) return -1;
+    }
+    return nops > 0 ? nvar : -1;
+}
+
+static int compareRules(const void *a, const void *b) {
+    const Rule *x = (const Rule*)a, *y = (const Rule*)b;
+    if (x->isel != y->isel) return x->isel - y->isel;
+    return strcmp(x->shape, y->shape);
+}
+
+// isel TAB shape TAB cycles TAB instr; instr; ...
+static int parseRule(char *line, Rule *rule) {
+    char *shape, *code, *p, *end;
+    Instr *in;
+    int r;
+
+    if ((shape = strchr(line, '\t')) == NULL || (p = strchr(shape + 1, '\t')) == NULL ||
+        (code = strchr(p + 1, '\t')) == NULL) {
+        return 0;
+    }
+    *shape++ = *p = *code++ = '\0';
+    if (strlen(shape) >= MAXSHAPE) return 0;
+    strcpy(rule->shape, shape);
+    rule->isel = atoi(line);
+    rule->regs = 1;
+    for (rule->n = 0, p = code; *p; p = *end ? end + 1 : end) {
+        if ((end = strchr(p, ';')) == NULL) end = p + strlen(p);
+        if (rule->n == RULELEN) return 0;
+        while (*p == ' ') p++;
+        r = *end;
+        *end = '\0';
+        if (!parseInstr(p, &rule->code[rule->n])) return 0;
+        *end = (char)r;
+        // registers and the addresses of the variables only
+        in = &rule->code[rule->n++];
+        if (in->op == OP_EXIT || isVectorOp(in->op) || in->dst.kind != OPND_REG) return 0;
+        if (in->dst.val >= RULEREGS || (in->src.kind == OPND_REG && in->src.val >= RULEREGS)) return 0;
+        if (in->src.kind == OPND_MEM && (in->src.val % 4 != 0 || in->src.val / 4 >= RULEVARS)) return 0;
+        if (in->dst.val >= rule->regs) rule->regs = in->dst.val + 1;
+    }
+    return rule->n > 0;
+}
+
+int loadRules(const char *path) {
+    FILE *fp = fopen(path, "r");
+    char line[1024];
+    int cap = 0, lineno = 0;
+    size_t len;
+
+    if (fp == NULL) {
+        perror(path);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        lineno++;
+        len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        if (len == 0 || line[0] == '#') continue;
+        for (size_t i = 0; i < len; i++)
+            key = (key ^ (unsigned char)line[i]) * 1099511628211ull;
+        if (nrules == cap) {
+            cap = cap ? cap * 2 : 64;
+            rules = (Rule*)realloc(rules, sizeof(Rule) * cap);
+        }
+        if (!parseRule(line, &rules[nrules])) {
+            fprintf(stderr, "%s:%d: bad rule\n", path, lineno);
+            fclose(fp);
+            return 0;
+        }
+        nrules++;
+    }
+    fclose(fp);
+    qsort(rules, nrules, sizeof(Rule), compareRules);
+    return 1;
+}
+
+unsigned long long rulesKey(void) {
+    return key;
+}
+
+int applyRule(Tree *t) {
+    const char *names[RULEVARS], *target;
+    char buf[64];
+    int idx[RULEVARS], nvar, i, dst, base;
+    Rule want, *rule;
+    Instr in;
+
+    if (nrules == 0 || t->n == 0 || t->node[t->n - 1].data != ASSIGN) return 0;
+    if ((nvar = exprShape(t, t->node[t->n - 1].right, want.shape, names)) < 0) return 0;
+    target = nodeLexeme(t, t->node[t->n - 1].left);
+    want.isel = optIsel;
+    if ((rule = (Rule*)bsearch(&want, rules, nrules, sizeof(Rule), compareRules)) == NULL) return 0;
+    // undefined variables are left to evaluateTree to report; the rule
+    // was timed against a target that is not one of its variables, which
+    // -fisel can turn into an update in place
+    for (i = 0; i < nvar; i++) {
+        if (strcmp(names[i], target) == 0) {
+            if (optIsel) return 0;
+        } else if (getvariable((char*)names[i]) == -1) {
+            return 0;
+        }
+    }
+    // promoted variables live in registers, not at their address
+    for (i = 0; i < sbcount; i++)
+        if (table[i].reg >= 0) return 0;
+    // superopt searched the code of the first target
+    for (i = 0; i < rule->n; i++)
+        if (!targetAccepts(backend, &rule->code[i])) return 0;
+
+    if ((dst = getvariable((char*)target)) == -1) dst = setvariable((char*)target);
+    for (i = 0; i < nvar; i++)
+        idx[i] = getvariable((char*)names[i]);
+    base = allocateRegister();
+    for (i = 1; i < rule->regs; i++)
+        allocateRegister();
+    for (i = 0; i < rule->n; i++) {
+        in = rule->code[i];
+        in.dst.val += base;
+        if (in.src.kind == OPND_REG) in.src.val += base;
+        else if (in.src.kind == OPND_MEM) in.src.val = varAddress(idx[in.src.val / 4]);
+        formatInstr(&in, buf);
+        emit("%s\n", buf);
+    }
+    emit("%s [%d] r%d\n", backend->mnemonic[OP_MOV], varAddress(dst), base);
+    // the result stays allocated like the one of evaluateTree
+    for (i = 1; i < rule->regs; i++)
+        freeRegister();
+    return 1;
+}
@@ -0,0 +1,34 @@
+#ifndef __RULES__
+#define __RULES__
+
+#include "parser.h"
+#include "isa.h"
+
+#define RULEOPS 4       // operators of a shape
+#define RULEVARS 3      // variables of a shape
+#define RULEREGS 3      // registers the code of a rule may use
+#define RULELEN 8       // instructions of a rule
+#define MAXSHAPE 128
+
+// Rules loaded with -frules
+extern int nrules;
+
+// Canonical shape of the expression at node i, of at most RULEOPS
+// operators over at most RULEVARS variables and constants: its prefix
+// form with the variables renamed v0, v1, ... in the order they first
+// appear. Set names[i] to the variable renamed vi; return the number of
+// variables, or -1 if the expression has no shape.
+extern int exprShape(Tree *t, int i, char *shape, const char **names);
+
+// Read a rule database written by superopt; return 0 on error. A rule
+// reads vi at [4*i] and leaves its result in r0.
+extern int loadRules(const char *path);
+
+// Hash of the rules loaded, so that cached code changes with them
+extern unsigned long long rulesKey(void);
+
+// Print the code of an assignment whose right side has a rule, the way
+// evaluateTree would leave it; return 0 if there is no rule for it
+extern int applyRule(Tree *t);
+
+#endif // __RULES__
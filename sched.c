@@ -0,0 +1,320 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "sched.h"
+#include "parser.h"
+#include "codeGen.h"
+#include "memstat.h"
+
+// Latencies the schedule is built for
+static SimConfig cost;
+
+static long long cyclesBefore = 0, cyclesAfter = 0, reordered = 0;
+static pthread_mutex_t schedLock = PTHREAD_MUTEX_INITIALIZER;
+
+// A register of the statement: the fixed registers of promoted variables
+// keep their number, temporaries are renamed. A temporary value is
+// defined by one instruction and may be overwritten in place by one
+// two-address instruction, its killer, which reads it last.
+typedef struct {
+    int def;            // defining instruction
+    int uses;           // reads not yet scheduled
+    int reg;            // physical register once allocated
+    int tied;           // value whose register this one takes over, or -1
+} Value;
+
+// Operands of an instruction as values, -1 for none
+typedef struct {
+    int src;
+    int dst;            // value read through the destination operand
+    int def;            // value the instruction defines
+    int npred;          // unscheduled predecessors
+    int prio;           // latency of the longest path to the end
+    long long ready;    // cycle the operands are ready
+} Node;
+
+typedef struct {
+    int to;
+    int next;
+} Edge;
+
+static _Thread_local Value *vals;
+static _Thread_local Node *nodes;
+static _Thread_local Edge *edges;
+static _Thread_local int *first, *order;
+static _Thread_local Instr *out;
+static _Thread_local int nodeCap, edgeCap, nedges;
+
+int loadScheduleCost(const char *path) {
+    initSimConfig(&cost);
+    return path == NULL || loadSimConfig(&cost, path);
+}
+
+static void addEdge(int from, int to) {
+    if (from < 0 || from == to) return;
+    if (nedges == edgeCap) {
+        edges = (Edge*)memRealloc(MEM_CODE, edges, sizeof(Edge) * edgeCap,
+            sizeof(Edge) * (edgeCap ? edgeCap * 2 : 256));
+        edgeCap = edgeCap ? edgeCap * 2 : 256;
+    }
+    edges[nedges].to = to;
+    edges[nedges].next = first[from];
+    first[from] = nedges++;
+    nodes[to].npred++;
+}
+
+static void reserve(int n) {
+    if (n <= nodeCap) return;
+    nodes = (Node*)memRealloc(MEM_CODE, nodes, sizeof(Node) * nodeCap, sizeof(Node) * n * 2);
+    first = (int*)memRealloc(MEM_CODE, first, sizeof(int) * nodeCap, sizeof(int) * n * 2);
+    order = (int*)memRealloc(MEM_CODE, order, sizeof(int) * nodeCap, sizeof(int) * n * 2);
+    out = (Instr*)memRealloc(MEM_CODE, out, sizeof(Instr) * nodeCap, sizeof(Instr) * n * 2);
+    // a value per instruction at most
+    vals = (Value*)memRealloc(MEM_CODE, vals, sizeof(Value) * nodeCap, sizeof(Value) * n * 2);
+    nodeCap = n * 2;
+}
+
+// Dependencies on a location that is not renamed: a memory word or a
+// fixed register. writer is its last writer, readers the instructions
+// that read it since, kept in a list per location.
+typedef struct {
+    int writer;
+    int nreaders;
+    int *readers;
+    int cap;
+} Location;
+
+static _Thread_local Location locs[MAXREGS + SIMMEM / 4];
+
+static void readLoc(Location *l, int i) {
+    addEdge(l->writer, i);
+    if (l->nreaders == l->cap) {
+        l->readers = (int*)memRealloc(MEM_CODE, l->readers, sizeof(int) * l->cap,
+            sizeof(int) * (l->cap ? l->cap * 2 : 8));
+        l->cap = l->cap ? l->cap * 2 : 8;
+    }
+    l->readers[l->nreaders++] = i;
+}
+
+static void writeLoc(Location *l, int i) {
+    int k;
+
+    addEdge(l->writer, i);
+    for (k = 0; k < l->nreaders; k++)
+        addEdge(l->readers[k], i);
+    l->writer = i;
+    l->nreaders = 0;
+}
+
+static Location *memLoc(int addr) {
+    return &locs[MAXREGS + addr / 4];
+}
+
+// Addresses the simulator can access without a fault
+static int wordAddr(int addr) {
+    return addr >= 0 && addr % 4 == 0 && addr + 4 <= SIMMEM;
+}
+
+static int readsDst(const Instr *in) {
+    return in->op != OP_MOV;
+}
+
+// Build the dependency graph; return 0 if the code cannot be scheduled
+static int buildGraph(const Instr *ins, int n, const int *fixed) {
+    int cur[MAXREGS], i, k, r, v, nvals = 0, lastDiv = -1, nstores = 0, *stores = order;
+
+    for (r = 0; r < MAXREGS; r++) {
+        cur[r] = -1;
+        locs[r].writer = -1;
+        locs[r].nreaders = 0;
+    }
+    for (i = 0; i < n; i++) {
+        if (isVectorOp(ins[i].op) || ins[i].op == OP_EXIT) return 0;
+        if (ins[i].dst.kind == OPND_MEM && !wordAddr(ins[i].dst.val)) return 0;
+        if (ins[i].src.kind == OPND_MEM && !wordAddr(ins[i].src.val)) return 0;
+        if (ins[i].dst.kind == OPND_MEM) {
+            memLoc(ins[i].dst.val)->writer = -1;
+            memLoc(ins[i].dst.val)->nreaders = 0;
+        }
+        if (ins[i].src.kind == OPND_MEM) {
+            memLoc(ins[i].src.val)->writer = -1;
+            memLoc(ins[i].src.val)->nreaders = 0;
+        }
+    }
+    nedges = 0;
+    for (i = 0; i < n; i++) {
+        const Instr *in = &ins[i];
+        Node *nd = &nodes[i];
+
+        first[i] = -1;
+        nd->npred = 0;
+        nd->src = nd->dst = nd->def = -1;
+
+        // reads
+        if (in->src.kind == OPND_REG) {
+            r = in->src.val;
+            if (fixed[r]) readLoc(&locs[r], i);
+            else if ((nd->src = cur[r]) < 0) return 0;
+            else addEdge(vals[nd->src].def, i);
+        } else if (in->src.kind == OPND_MEM) {
+            readLoc(memLoc(in->src.val), i);
+        }
+        if (in->dst.kind == OPND_REG && readsDst(in)) {
+            r = in->dst.val;
+            if (fixed[r]) readLoc(&locs[r], i);
+            else if ((nd->dst = cur[r]) < 0) return 0;
+            else addEdge(vals[nd->dst].def, i);
+        } else if (in->dst.kind == OPND_MEM && readsDst(in)) {
+            readLoc(memLoc(in->dst.val), i);
+        }
+
+        // writes
+        if (in->dst.kind == OPND_REG) {
+            r = in->dst.val;
+            if (fixed[r]) {
+                writeLoc(&locs[r], i);
+            } else {
+                v = nvals++;
+                vals[v].def = i;
+                vals[v].uses = 0;
+                vals[v].tied = nd->dst;
+                nd->def = cur[r] = v;
+            }
+        } else if (in->dst.kind == OPND_MEM) {
+            writeLoc(memLoc(in->dst.val), i);
+            // a DIV that traps must see the stores before it and none after
+            addEdge(lastDiv, i);
+            stores[nstores++] = i;
+        }
+        if (in->op == OP_DIV) {
+            for (k = 0; k < nstores; k++)
+                addEdge(stores[k], i);
+            nstores = 0;
+            lastDiv = i;
+        }
+        if (nd->src >= 0) vals[nd->src].uses++;
+        if (nd->dst >= 0) vals[nd->dst].uses++;
+    }
+    // the other readers of a value come before the instruction that
+    // overwrites it in place
+    for (i = 0; i < n; i++) {
+        if (nodes[i].def < 0 || (v = vals[nodes[i].def].tied) < 0) continue;
+        for (k = vals[v].def + 1; k < i; k++)
+            if (nodes[k].src == v || nodes[k].dst == v) addEdge(k, i);
+    }
+    return 1;
+}
+
+// Pick instructions by earliest start, then longest path to the end, and
+// rename the temporaries on the way; return 0 if the registers run out
+static int listSchedule(const Instr *ins, int n, const int *fixed) {
+    long long t = 0, start, bestStart = 0, regReady[MAXREGS];
+    int isFree[MAXREGS], nfree = 0, i, k, e, r, best, v, need, give;
+
+    for (r = 0; r < MAXREGS; r++) {
+        isFree[r] = r < targetRegs && !fixed[r];
+        nfree += isFree[r];
+        regReady[r] = 0;
+    }
+    for (i = 0; i < n; i++)
+        nodes[i].ready = 0;
+    for (k = 0; k < n; k++) {
+        best = -1;
+        for (i = 0; i < n; i++) {
+            if (nodes[i].npred != 0) continue;
+            // a new value needs a register unless a read frees one now
+            v = nodes[i].def;
+            need = v >= 0 && vals[v].tied < 0;
+            give = nodes[i].src >= 0 && vals[nodes[i].src].uses == 1 && (v < 0 || vals[v].tied != nodes[i].src);
+            if (need && nfree == 0 && !give) continue;
+            start = nodes[i].ready > t ? nodes[i].ready : t;
+            if (best < 0 || start < bestStart ||
+                (start == bestStart && nodes[i].prio > nodes[best].prio)) {
+                best = i;
+                bestStart = start;
+            }
+        }
+        if (best < 0) return 0;
+        order[k] = best;
+        nodes[best].npred = -1;
+        out[k] = ins[best];
+
+        // read, then free the registers of values read for the last time
+        if ((v = nodes[best].src) >= 0) {
+            out[k].src.val = vals[v].reg;
+            if (--vals[v].uses == 0 && (nodes[best].def < 0 || vals[nodes[best].def].tied != v)) {
+                isFree[vals[v].reg] = 1;
+                nfree++;
+            }
+        }
+        if ((v = nodes[best].dst) >= 0) {
+            out[k].dst.val = vals[v].reg;
+            vals[v].uses--;
+        }
+        if ((v = nodes[best].def) >= 0) {
+            if (vals[v].tied >= 0) {
+                vals[v].reg = vals[vals[v].tied].reg;
+            } else {
+                // the free register written longest ago
+                for (r = 0, vals[v].reg = -1; r < MAXREGS; r++)
+                    if (isFree[r] && (vals[v].reg < 0 || regReady[r] < regReady[vals[v].reg]))
+                        vals[v].reg = r;
+                isFree[vals[v].reg] = 0;
+                nfree--;
+            }
+            out[k].dst.val = vals[v].reg;
+            regReady[vals[v].reg] = bestStart + instrLatency(&cost, &ins[best]);
+            if (vals[v].uses == 0) {
+                isFree[vals[v].reg] = 1;
+                nfree++;
+            }
+        }
+        t = bestStart + 1;
+        for (e = first[best]; e >= 0; e = edges[e].next) {
+            i = edges[e].to;
+            nodes[i].npred--;
+            if (bestStart + instrLatency(&cost, &ins[best]) > nodes[i].ready)
+                nodes[i].ready = bestStart + instrLatency(&cost, &ins[best]);
+        }
+    }
+    return 1;
+}
+
+int schedulePass(Instr *ins, int *n) {
+    int fixed[MAXREGS] = { 0 }, i, e, p;
+    long long before, after;
+
+    if (*n < 3) return 0;
+    reserve(*n);
+    for (i = 0; i < sbcount; i++)
+        if (table[i].reg >= 0) fixed[table[i].reg] = 1;
+    if (!buildGraph(ins, *n, fixed)) return 0;
+    for (i = *n - 1; i >= 0; i--) {
+        nodes[i].prio = 0;
+        for (e = first[i]; e >= 0; e = edges[e].next)
+            if (nodes[edges[e].to].prio > nodes[i].prio) nodes[i].prio = nodes[edges[e].to].prio;
+        nodes[i].prio += instrLatency(&cost, &ins[i]);
+    }
+    if (!listSchedule(ins, *n, fixed)) return 0;
+
+    before = blockCycles(&cost, ins, *n);
+    after = blockCycles(&cost, out, *n);
+    if (after >= before) return 0;
+    memcpy(ins, out, sizeof(Instr) * *n);
+    pthread_mutex_lock(&schedLock);
+    cyclesBefore += before;
+    cyclesAfter += after;
+    reordered++;
+    pthread_mutex_unlock(&schedLock);
+    for (i = p = 0; i < *n; i++)
+        p += order[i] != i;
+    return p;
+}
+
+void scheduleStats(long long *before, long long *after, long long *statements) {
+    *before = cyclesBefore;
+    *after = cyclesAfter;
+    *statements = reordered;
+}
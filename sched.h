@@ -0,0 +1,20 @@
+#ifndef __SCHED__
+#define __SCHED__
+
+#include "isa.h"
+#include "sim.h"
+
+// Load the latency table the scheduler plans with, the defaults if path
+// is NULL; return 0 if the file cannot be read. Call it before compiling.
+extern int loadScheduleCost(const char *path);
+
+// List scheduling: reorder the instructions of a statement by their
+// dependencies, longest latency path first, renaming the temporary
+// registers. The new order is kept only if blockCycles says it is faster.
+// Return the number of instructions that moved.
+extern int schedulePass(Instr *ins, int *n);
+
+// Estimated cycles of the statements the pass reordered, before and after
+extern void scheduleStats(long long *before, long long *after, long long *statements);
+
+#endif // __SCHED__
@@ -0,0 +1,281 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+void initSimConfig(SimConfig *cfg) {
+    int op;
+    for (op = 0; op < OPCOUNT; op++)
+        cfg->latency[op] = 1;
+    cfg->latency[OP_MUL] = 3;
+    cfg->latency[OP_DIV] = 20;
+    cfg->latency[OP_VMUL] = 3;
+    cfg->load = 4;
+    cfg->store = 1;
+    cfg->latency[OP_VLOAD] = cfg->load;
+    cfg->latency[OP_VSTORE] = cfg->store;
+    cfg->target = &targets[0];
+    cfg->nregs = cfg->target->regs;
+}
+
+int loadSimConfig(SimConfig *cfg, const char *path) {
+    char line[256], name[64];
+    int value, op, lineno = 0;
+    FILE *fp = fopen(path, "r");
+
+    if (fp == NULL) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        ++lineno;
+        if (sscanf(line, "%63s", name) != 1 || name[0] == '#') continue;
+        if (sscanf(line, "%63s %d", name, &value) != 2 || value < 0) {
+            fprintf(stderr, "%s:%d: expected NAME value\n", path, lineno);
+            fclose(fp);
+            return 0;
+        }
+        for (op = 0; op < OPCOUNT; op++)
+            if (strcmp(name, opcodeName[op]) == 0) break;
+        if (op < OPCOUNT) cfg->latency[op] = value;
+        else if (strcmp(name, "LOAD") == 0) cfg->load = value;
+        else if (strcmp(name, "STORE") == 0) cfg->store = value;
+        else if (strcmp(name, "REGS") == 0 && value <= MAXREGS) cfg->nregs = value;
+        else {
+            fprintf(stderr, "%s:%d: unknown entry %s\n", path, lineno, name);
+            fclose(fp);
+            return 0;
+        }
+    }
+    fclose(fp);
+    return 1;
+}
+
+void resetMachine(Machine *m, const SimConfig *cfg) {
+    memset(m, 0, sizeof(*m));
+    m->cfg = cfg;
+}
+
+int instrLatency(const SimConfig *cfg, const Instr *ins) {
+    int latency = cfg->latency[ins->op];
+
+    if (isVectorOp(ins->op)) return latency;
+    if (ins->op == OP_MOV && ins->src.kind == OPND_MEM) return cfg->load;
+    if (ins->op == OP_MOV && ins->dst.kind == OPND_MEM) return cfg->store;
+    // a memory operand of an ALU op is loaded first, a memory destination
+    // is also stored after
+    if (ins->src.kind == OPND_MEM) latency += cfg->load;
+    if (ins->dst.kind == OPND_MEM) latency += cfg->load + cfg->store;
+    return latency;
+}
+
+static int fault(Machine *m, const char *msg) {
+    m->fault = msg;
+    m->halted = 1;
+    return 0;
+}
+
+// Check an operand against the register limit and the data memory
+static int checkOperand(Machine *m, const Operand *opnd) {
+    if (opnd->kind == OPND_REG && (opnd->val < 0 || opnd->val >= m->cfg->nregs))
+        return fault(m, "register out of range");
+    if (opnd->kind == OPND_MEM && (opnd->val < 0 || opnd->val >= SIMMEM || opnd->val % 4 != 0))
+        return fault(m, "bad memory address");
+    return 1;
+}
+
+static long long operandReady(const Machine *m, const Operand *opnd) {
+    if (opnd->kind == OPND_REG) return m->regReady[opnd->val];
+    if (opnd->kind == OPND_MEM) return m->memReady[opnd->val / 4];
+    if (opnd->kind == OPND_VREG) return m->vregReady[opnd->val];
+    return 0;
+}
+
+// The words a VLOAD or VSTORE moves are ready when the last of them is
+static long long vectorReady(const Machine *m, const Operand *opnd) {
+    long long ready = 0;
+    int i;
+
+    if (opnd->kind != OPND_MEM) return operandReady(m, opnd);
+    for (i = 0; i < VLANES; i++)
+        if (m->memReady[opnd->val / 4 + i] > ready) ready = m->memReady[opnd->val / 4 + i];
+    return ready;
+}
+
+// Execute a vector instruction, timed like a scalar one
+static int vectorStep(Machine *m, const Instr *ins) {
+    long long start = m->issue, done;
+    int i, *dst, a, b;
+    unsigned int r;
+
+    if (ins->dst.kind == OPND_MEM && ins->dst.val + 4 * VLANES > SIMMEM)
+        return fault(m, "bad memory address");
+    if (ins->src.kind == OPND_MEM && ins->src.val + 4 * VLANES > SIMMEM)
+        return fault(m, "bad memory address");
+    if (vectorReady(m, &ins->src) > start) start = vectorReady(m, &ins->src);
+    if (vectorReady(m, &ins->dst) > start) start = vectorReady(m, &ins->dst);
+    m->stalls += start - m->issue;
+    done = start + instrLatency(m->cfg, ins);
+
+    switch (ins->op) {
+    case OP_VLOAD:
+        memcpy(m->vreg[ins->dst.val], &m->mem[ins->src.val / 4], sizeof(int) * VLANES);
+        m->vregReady[ins->dst.val] = done;
+        m->loads++;
+        break;
+    case OP_VSTORE:
+        memcpy(&m->mem[ins->dst.val / 4], m->vreg[ins->src.val], sizeof(int) * VLANES);
+        for (i = 0; i < VLANES; i++)
+            m->memReady[ins->dst.val / 4 + i] = done;
+        m->stores++;
+        break;
+    default:
+        dst = m->vreg[ins->dst.val];
+        for (i = 0; i < VLANES; i++) {
+            a = dst[i];
+            b = m->vreg[ins->src.val][i];
+            switch (ins->op) {
+            case OP_VADD: r = (unsigned int)a + (unsigned int)b; break;
+            case OP_VSUB: r = (unsigned int)a - (unsigned int)b; break;
+            case OP_VMUL: r = (unsigned int)a * (unsigned int)b; break;
+            case OP_VAND: r = (unsigned int)(a & b); break;
+            case OP_VOR:  r = (unsigned int)(a | b); break;
+            default:      r = (unsigned int)(a ^ b); break;
+            }
+            dst[i] = (int)r;
+        }
+        m->vregReady[ins->dst.val] = done;
+        break;
+    }
+    m->issue = start + 1;
+    if (done > m->cycles) m->cycles = done;
+    m->instrs++;
+    m->count[ins->op]++;
+    return 1;
+}
+
+static int readOperand(const Machine *m, const Operand *opnd) {
+    if (opnd->kind == OPND_REG) return m->reg[opnd->val];
+    if (opnd->kind == OPND_MEM) return m->mem[opnd->val / 4];
+    return opnd->val;
+}
+
+// Ready cycles of the operands of a block, memory words looked up in the
+// few the block has written
+typedef struct {
+    long long reg[MAXREGS];
+    int addr[64];
+    long long mem[64];
+    int nmem;
+    long long spare;    // immediates, and what does not fit
+} BlockReady;
+
+static long long *blockOperand(BlockReady *r, const Operand *opnd) {
+    int i;
+
+    r->spare = 0;
+    if (opnd->kind == OPND_REG) return &r->reg[opnd->val];
+    if (opnd->kind != OPND_MEM) return &r->spare;
+    for (i = 0; i < r->nmem && r->addr[i] != opnd->val; i++);
+    if (i == r->nmem) {
+        // an address beyond the table is taken as ready, like memory the
+        // block has not written
+        if (r->nmem == 64) return &r->spare;
+        r->addr[r->nmem] = opnd->val;
+        r->mem[r->nmem++] = 0;
+    }
+    return &r->mem[i];
+}
+
+long long blockCycles(const SimConfig *cfg, const Instr *ins, int n) {
+    BlockReady r;
+    long long issue = 0, start, done, cycles = 0, *dst;
+    int i;
+
+    memset(r.reg, 0, sizeof(r.reg));
+    r.nmem = 0;
+    for (i = 0; i < n; i++) {
+        start = issue;
+        if (*blockOperand(&r, &ins[i].src) > start) start = *blockOperand(&r, &ins[i].src);
+        dst = blockOperand(&r, &ins[i].dst);
+        if (*dst > start) start = *dst;
+        done = start + instrLatency(cfg, &ins[i]);
+        if (ins[i].dst.kind == OPND_REG || ins[i].dst.kind == OPND_MEM) *dst = done;
+        issue = start + 1;
+        if (done > cycles) cycles = done;
+    }
+    return cycles;
+}
+
+int step(Machine *m, const Instr *ins) {
+    long long start = m->issue, done;
+    unsigned int a, b, result = 0;
+
+    if (m->halted) return 0;
+    if (!checkOperand(m, &ins->dst) || !checkOperand(m, &ins->src)) return 0;
+    if (!targetAccepts(m->cfg->target, ins)) return fault(m, "not an instruction of the target");
+    if (isVectorOp(ins->op)) return vectorStep(m, ins);
+
+    // in-order issue: wait for the sources and for the previous write of dst
+    if (operandReady(m, &ins->src) > start) start = operandReady(m, &ins->src);
+    if (operandReady(m, &ins->dst) > start) start = operandReady(m, &ins->dst);
+    m->stalls += start - m->issue;
+    done = start + instrLatency(m->cfg, ins);
+
+    a = (unsigned int)readOperand(m, &ins->dst);
+    b = (unsigned int)readOperand(m, &ins->src);
+    switch (ins->op) {
+    case OP_MOV: result = b; break;
+    case OP_ADD: result = a + b; break;
+    case OP_SUB: result = a - b; break;
+    case OP_MUL: result = a * b; break;
+    case OP_AND: result = a & b; break;
+    case OP_OR:  result = a | b; break;
+    case OP_XOR: result = a ^ b; break;
+    case OP_INC: result = a + 1; break;
+    case OP_DEC: result = a - 1; break;
+    case OP_DIV:
+        if (b == 0) return fault(m, "division by zero");
+        if ((int)a == (int)0x80000000 && (int)b == -1) result = a;
+        else result = (unsigned int)((int)a / (int)b);
+        break;
+    case OP_EXIT:
+        m->halted = 1;
+        m->exitcode = ins->dst.val;
+        break;
+    default:
+        return fault(m, "bad opcode");
+    }
+
+    if (ins->dst.kind == OPND_REG) {
+        m->reg[ins->dst.val] = (int)result;
+        m->regReady[ins->dst.val] = done;
+    } else if (ins->dst.kind == OPND_MEM) {
+        m->mem[ins->dst.val / 4] = (int)result;
+        m->memReady[ins->dst.val / 4] = done;
+        m->stores++;
+    }
+    if (ins->src.kind == OPND_MEM || (ins->dst.kind == OPND_MEM && ins->op != OP_MOV)) m->loads++;
+
+    m->issue = start + 1;
+    if (done > m->cycles) m->cycles = done;
+    m->instrs++;
+    m->count[ins->op]++;
+    return !m->halted;
+}
+
+void printSimReport(FILE *fp, const Machine *m) {
+    int op, word = m->cfg->target->wordSize / 4;
+    fprintf(fp, "cycles %lld\n", m->cycles);
+    fprintf(fp, "instructions %lld\n", m->instrs);
+    fprintf(fp, "stalls %lld\n", m->stalls);
+    fprintf(fp, "loads %lld\n", m->loads);
+    fprintf(fp, "stores %lld\n", m->stores);
+    for (op = 0; op < OPCOUNT; op++)
+        if (m->count[op] != 0) fprintf(fp, "%s %lld\n", opcodeName[op], m->count[op]);
+    fprintf(fp, "x %d\ny %d\nz %d\n", m->mem[0], m->mem[word], m->mem[2 * word]);
+    if (m->fault != NULL) fprintf(fp, "fault %s\n", m->fault);
+    else if (m->halted) fprintf(fp, "exit %d\n", m->exitcode);
+    else fprintf(fp, "exit none\n");
+}
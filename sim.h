@@ -0,0 +1,60 @@
+#ifndef __SIM__
+#define __SIM__
+
+#include <stdio.h>
+#include "isa.h"
+
+#define SIMMEM 4096     // bytes of data memory
+
+// Latency table and machine limits
+typedef struct {
+    int latency[OPCOUNT];   // cycles until the result of an opcode is ready
+    int load;               // MOV rN [addr]
+    int store;              // MOV [addr] rN
+    int nregs;              // registers available, r0 .. r(nregs-1)
+    const Target *target;   // instructions accepted and where x, y and z live
+} SimConfig;
+
+// State of the simulated machine and its counters
+typedef struct {
+    const SimConfig *cfg;
+    int reg[MAXREGS];
+    int mem[SIMMEM / 4];
+    long long regReady[MAXREGS];
+    int vreg[MAXVREGS][VLANES];
+    long long vregReady[MAXVREGS];
+    long long memReady[SIMMEM / 4];
+    long long issue;        // first cycle the next instruction may issue
+    long long cycles;       // cycle the last result became ready
+    long long stalls;
+    long long instrs;
+    long long count[OPCOUNT];
+    long long loads, stores;
+    int halted;
+    int exitcode;
+    const char *fault;      // set when execution stopped on an error
+} Machine;
+
+// Fill in the default latency table
+extern void initSimConfig(SimConfig *cfg);
+
+// Read "NAME value" lines (opcodes, LOAD, STORE, REGS), return 0 on error
+extern int loadSimConfig(SimConfig *cfg, const char *path);
+
+// Clear registers, memory and counters
+extern void resetMachine(Machine *m, const SimConfig *cfg);
+
+// Latency of one instruction under cfg
+extern int instrLatency(const SimConfig *cfg, const Instr *ins);
+
+// Cycles of a straight-line block started on an idle machine, timed like
+// step but without executing it
+extern long long blockCycles(const SimConfig *cfg, const Instr *ins, int n);
+
+// Execute one instruction, return 0 if the machine halted or faulted
+extern int step(Machine *m, const Instr *ins);
+
+// Print cycles, instruction counts and the final x, y and z
+extern void printSimReport(FILE *fp, const Machine *m);
+
+#endif // __SIM__
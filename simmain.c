@@ -0,0 +1,71 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+// Cycle-level simulator for the code printed by the compiler
+// Usage: sim [-t target] [-c latency.cfg] [-r nregs] [-v] [file]
+// Lines that are not instructions (the prefix dump) are skipped
+// -t runs the code of a -ftarget of the compiler, with its registers
+// -v prints the issue cycle of every instruction
+
+static void usage(void) {
+    fprintf(stderr, "usage: sim [-t target] [-c latency.cfg] [-r nregs] [-v] [file]\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    SimConfig cfg;
+    static Machine m;
+    Instr ins;
+    char line[1024], text[64];
+    const char *path = NULL;
+    int i, verbose = 0, lineno = 0, nregs = 0;
+    long long skipped = 0;
+    FILE *fp = stdin;
+
+    initSimConfig(&cfg);
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            if (!loadSimConfig(&cfg, argv[++i])) return 2;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            if ((cfg.target = findTarget(argv[++i])) == NULL) usage();
+            cfg.nregs = cfg.target->regs;
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            nregs = atoi(argv[++i]);
+            if (nregs <= 0 || nregs > MAXREGS) usage();
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else if (argv[i][0] == '-' || path != NULL) {
+            usage();
+        } else {
+            path = argv[i];
+        }
+    }
+    if (nregs != 0) cfg.nregs = nregs;
+    if (path != NULL && (fp = fopen(path, "r")) == NULL) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return 2;
+    }
+
+    resetMachine(&m, &cfg);
+    while (!m.halted && fgets(line, sizeof(line), fp) != NULL) {
+        ++lineno;
+        if (!parseInstr(line, &ins)) {
+            skipped++;
+            continue;
+        }
+        step(&m, &ins);
+        if (verbose) {
+            formatInstr(&ins, text);
+            fprintf(stderr, "%6lld  %s\n", m.issue - 1, text);
+        }
+        if (m.fault != NULL) fprintf(stderr, "line %d: %s\n", lineno, m.fault);
+    }
+    if (fp != stdin) fclose(fp);
+
+    printSimReport(stdout, &m);
+    printf("skipped %lld\n", skipped);
+    return m.fault != NULL ? 1 : 0;
+}
@@ -0,0 +1,278 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "slp.h"
+#include "codeGen.h"
+#include "passes.h"
+#include "isa.h"
+#include "trace.h"
+
+int optSlp = 0;
+
+#define MAXLEAVES 32    // variables read by one statement of a group
+
+static Tree **trees = NULL;
+static int ntrees = 0;
+static int resolved = 0;    // statements whose variables are all defined
+
+// New index of every variable, and the variable at every new index;
+// the address of a variable is 4 times its index
+static int slot[TBLSIZE];
+static int owner[TBLSIZE];
+
+static int vectorOp(Tree *t, int i) {
+    switch (t->node[i].data) {
+    case ADDSUB:
+    case AND:
+    case OR:
+    case XOR:
+        return 1;
+    case MULDIV:
+        return t->node[i].op == OP_MUL;
+    default:
+        return 0;
+    }
+}
+
+// Right side of the assignment at the root
+static int rhs(Tree *t) {
+    return t->node[t->n - 1].right;
+}
+
+// Same operators in the same places, variables at the leaves; the
+// shape follows from the kinds, so the nodes are compared in order
+static int sameShape(Tree *a, Tree *b) {
+    int i = firstNode(a, rhs(a)), j = firstNode(b, rhs(b));
+
+    if (rhs(a) - i != rhs(b) - j) return 0;
+    for (; i <= rhs(a); i++, j++) {
+        if (a->node[i].data == ID || b->node[j].data == ID) {
+            if (a->node[i].data != b->node[j].data) return 0;
+        } else if (!vectorOp(a, i) || a->node[i].data != b->node[j].data || a->node[i].op != b->node[j].op) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int countLeaves(Tree *t) {
+    int n = 0;
+    for (int i = firstNode(t, rhs(t)); i <= rhs(t); i++)
+        n += t->node[i].data == ID;
+    return n;
+}
+
+// Variables at the leaves of the right side, left to right
+static int leaves(Tree *t, int *var) {
+    int n = 0;
+    for (int i = firstNode(t, rhs(t)); i <= rhs(t); i++)
+        if (t->node[i].data == ID) var[n++] = getvariable(nodeLexeme(t, i));
+    return n;
+}
+
+// Vector registers the code of the right side needs, allocated like
+// evaluateTree
+static int needRegs(Tree *t) {
+    int *need = (int*)treeScratch(t, sizeof(int));
+    int i, l, r;
+
+    for (i = firstNode(t, rhs(t)); i <= rhs(t); i++) {
+        if (t->node[i].data == ID) {
+            need[i] = 1;
+            continue;
+        }
+        l = need[t->node[i].left];
+        r = 1 + need[t->node[i].right];
+        need[i] = l > r ? l : r;
+    }
+    return need[rhs(t)];
+}
+
+// Give the variables of one vector VLANES consecutive indices, keeping
+// the ones already placed where they are
+static int place(const int *var) {
+    int base = 0, found = 0, i, j;
+
+    for (i = 0; i < VLANES; i++)
+        for (j = i + 1; j < VLANES; j++)
+            if (var[i] == var[j]) return 0;
+    for (i = 0; i < VLANES && !found; i++)
+        if (slot[var[i]] >= 0) {
+            base = slot[var[i]] - i;
+            found = 1;
+        }
+    // otherwise the first free run
+    for (j = 0; !found && j + VLANES <= TBLSIZE; j++) {
+        for (i = 0; i < VLANES && owner[j + i] == -1; i++);
+        if (i == VLANES) {
+            base = j;
+            found = 1;
+        }
+    }
+    if (!found || base < 0 || base + VLANES > TBLSIZE) return 0;
+    for (i = 0; i < VLANES; i++) {
+        if (slot[var[i]] >= 0 ? slot[var[i]] != base + i : owner[base + i] != -1) return 0;
+    }
+    for (i = 0; i < VLANES; i++) {
+        slot[var[i]] = base + i;
+        owner[base + i] = var[i];
+    }
+    return 1;
+}
+
+// Check that the VLANES statements from first can run as one: same shape,
+// no statement reads what an earlier one stores, distinct targets. Then
+// place their vectors, or leave the layout as it was.
+static int makeGroup(int first) {
+    int var[VLANES][MAXLEAVES], dst[VLANES], vec[VLANES];
+    int saveSlot[TBLSIZE], saveOwner[TBLSIZE];
+    int i, j, k, n = 0, unplaced = 0, nfree = 0, pass, fixed, ok = 1;
+    Tree *lane;
+
+    if (first + VLANES > resolved) return 0;
+    for (i = 0; i < VLANES; i++) {
+        lane = trees[first + i];
+        if (lane->node[lane->n - 1].data != ASSIGN || !sameShape(lane, trees[first])) return 0;
+        if (countLeaves(lane) > MAXLEAVES) return 0;
+        dst[i] = getvariable(nodeLexeme(lane, lane->node[lane->n - 1].left));
+        n = leaves(lane, var[i]);
+    }
+    if (needRegs(trees[first]) > MAXVREGS) return 0;
+    for (i = 0; i < VLANES; i++)
+        for (j = i + 1; j < VLANES; j++) {
+            if (dst[i] == dst[j]) return 0;
+            for (k = 0; k < n; k++)
+                if (var[j][k] == dst[i]) return 0;
+        }
+
+    memcpy(saveSlot, slot, sizeof(slot));
+    memcpy(saveOwner, owner, sizeof(owner));
+    // vectors pinned by a variable placed earlier go first, so that the
+    // free ones do not take their room; the second pass places the rest
+    // and checks all of them
+    for (pass = 0; pass < 2 && ok; pass++)
+        for (k = 0; k <= n && ok; k++) {
+            for (i = fixed = 0; i < VLANES; i++) {
+                vec[i] = k < n ? var[i][k] : dst[i];
+                fixed |= slot[vec[i]] >= 0;
+            }
+            if (fixed || pass == 1) ok = place(vec);
+        }
+    // the variables left must still fit in the table
+    for (i = 0; i < sbcount; i++)
+        unplaced += slot[i] < 0;
+    for (i = 0; i < TBLSIZE; i++)
+        nfree += owner[i] == -1;
+    if (!ok || unplaced > nfree) {
+        memcpy(slot, saveSlot, sizeof(slot));
+        memcpy(owner, saveOwner, sizeof(owner));
+        return 0;
+    }
+    return 1;
+}
+
+// Renumber the symbol table by the layout; the unused indices between
+// vectors get entries no identifier matches
+static void relayout(void) {
+    static Symbol old[TBLSIZE];
+    int i, n = 0;
+
+    for (i = 0; i < sbcount; i++) {
+        if (slot[i] >= 0) continue;
+        while (owner[n] != -1) n++;
+        slot[i] = n;
+        owner[n] = i;
+    }
+    memcpy(old, table, sizeof(Symbol) * sbcount);
+    for (i = n = 0; i < TBLSIZE; i++)
+        if (owner[i] != -1) n = i + 1;
+    for (i = 0; i < n; i++) {
+        if (owner[i] != -1) {
+            table[i] = old[owner[i]];
+        } else {
+            table[i].name[0] = '\0';
+            table[i].val = table[i].known = 0;
+            table[i].reg = -1;
+        }
+    }
+    sbcount = n;
+}
+
+static const char *vectorName(Opcode op) {
+    switch (op) {
+    case OP_ADD: return backend->mnemonic[OP_VADD];
+    case OP_SUB: return backend->mnemonic[OP_VSUB];
+    case OP_MUL: return backend->mnemonic[OP_VMUL];
+    case OP_AND: return backend->mnemonic[OP_VAND];
+    case OP_OR: return backend->mnemonic[OP_VOR];
+    default: return backend->mnemonic[OP_VXOR];
+    }
+}
+
+// The lanes of a node are the same node of every statement of the group;
+// the first lane gives the addresses of the vectors
+static int genVector(Tree *t) {
+    int *reg = (int*)treeScratch(t, sizeof(int));
+    int i, nowreg = 0;
+
+    for (i = firstNode(t, rhs(t)); i <= rhs(t); i++) {
+        if (t->node[i].data == ID) {
+            reg[i] = nowreg++;
+            emit("%s v%d [%d]\n", backend->mnemonic[OP_VLOAD], reg[i], varAddress(getvariable(nodeLexeme(t, i))));
+            continue;
+        }
+        reg[i] = reg[t->node[i].left];
+        emit("%s v%d v%d\n", vectorName((Opcode)t->node[i].op), reg[i], reg[t->node[i].right]);
+        nowreg--;
+    }
+    return reg[rhs(t)];
+}
+
+void compileVectorized(void) {
+    long long start = traceClock();
+    int failed = parseProgram(&trees, &ntrees, &resolved), i, j, groups = 0, reg;
+    char *starts;
+
+    traceSpan("parseProgram", start, "statements", ntrees);
+    start = traceClock();
+    for (i = 0; i < TBLSIZE; i++)
+        slot[i] = owner[i] = -1;
+    // x, y and z stay where the simulator and endProgram read them
+    for (i = 0; i < 3; i++)
+        slot[i] = owner[i] = i;
+    starts = (char*)calloc(ntrees + 1, 1);
+    for (i = 0; i < ntrees; i++) {
+        if (!makeGroup(i)) continue;
+        starts[i] = 1;
+        groups++;
+        i += VLANES - 1;
+    }
+    relayout();
+    traceSpan("vectorize", start, "groups", groups);
+
+    for (i = 0; i < ntrees; i++) {
+        if (!starts[i]) {
+            resetRegister();
+            compileStatement(trees[i]);
+            freeTree(trees[i]);
+            continue;
+        }
+        for (j = 0; j < VLANES; j++) {
+            printPrefix(trees[i + j]);
+            emit("\n");
+        }
+        reg = genVector(trees[i]);
+        emit("%s [%d] v%d\n", backend->mnemonic[OP_VSTORE], varAddress(getvariable(nodeLexeme(trees[i], trees[i]->node[trees[i]->n - 1].left))), reg);
+        for (j = 0; j < VLANES; j++)
+            freeTree(trees[i + j]);
+        i += VLANES - 1;
+    }
+    free(starts);
+    if (failed) {
+        emit("%s 1\n", backend->mnemonic[OP_EXIT]);
+        exit(0);
+    }
+    endProgram();
+    exit(0);
+}
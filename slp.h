@@ -0,0 +1,13 @@
+#ifndef __SLP__
+#define __SLP__
+
+// Enabled with -fslp: pack runs of VLANES adjacent independent statements
+// of the same shape into vector instructions
+extern int optSlp;
+
+// Compile the whole program, vectorizing the groups it finds and laying
+// out the variables so that the vectors of a group are contiguous in
+// memory. Exits like statement does.
+extern void compileVectorized(void);
+
+#endif // __SLP__
@@ -0,0 +1,136 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+#include "codeGen.h"
+#include "isel.h"
+#include "passes.h"
+#include "rules.h"
+
+typedef struct {
+    char magic[8];
+    char stamp[32];
+    uint64_t options;
+    int32_t nsym;
+    int32_t pad;
+    uint64_t codeLen;   // bytes of code after the symbols
+} SnapHeader;
+
+// A variable of the symbol table; its address is its index
+typedef struct {
+    char name[MAXLEN];
+    int32_t val;
+    int32_t known;
+} SnapSymbol;
+
+const char *snapshotSave = NULL;
+
+static OutBuf saved = { NULL, 0, 0 };
+static int collecting = 0;
+
+// Code the passes, the target and the rules generate differs
+static uint64_t optionsKey(void) {
+    return (pipelineKey() << 16 | (uint64_t)(backend - targets) << 8 | (uint64_t)targetRegs << 1 |
+        (uint64_t)optIsel) ^ rulesKey();
+}
+
+// Print the code collected so far and stop collecting
+static void releaseOutput(void) {
+    if (!collecting) return;
+    collecting = 0;
+    setOutput(NULL);
+    fwrite(saved.data, 1, saved.len, stdout);
+}
+
+void openSnapshotSave(const char *path) {
+    snapshotSave = path;
+    collecting = 1;
+    setOutput(&saved);
+    // a program that fails before its end prints its code and saves nothing
+    atexit(releaseOutput);
+}
+
+void saveSnapshot(void) {
+    static SnapSymbol sym[TBLSIZE];
+    SnapHeader header;
+    char tmp[4096];
+    FILE *fp;
+
+    if (!collecting) return;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "MCSNAP01", 8);
+    memcpy(header.stamp, buildStamp(), sizeof(header.stamp));
+    header.options = optionsKey();
+    header.nsym = sbcount;
+    header.codeLen = saved.len;
+    memset(sym, 0, sizeof(sym));
+    for (int i = 0; i < sbcount; i++) {
+        strcpy(sym[i].name, table[i].name);
+        sym[i].val = table[i].val;
+        sym[i].known = table[i].known;
+    }
+    snprintf(tmp, sizeof(tmp), "%s.tmp", snapshotSave);
+    if ((fp = fopen(tmp, "wb")) == NULL || fwrite(&header, sizeof(header), 1, fp) != 1 ||
+        fwrite(sym, sizeof(SnapSymbol), sbcount, fp) != (size_t)sbcount ||
+        fwrite(saved.data, 1, saved.len, fp) != saved.len || fclose(fp) != 0 ||
+        rename(tmp, snapshotSave) != 0) {
+        perror(snapshotSave);
+    }
+    releaseOutput();
+}
+
+int loadSnapshot(const char *path) {
+    const SnapHeader *header;
+    const SnapSymbol *sym;
+    const char *code;
+    struct stat st;
+    char *data;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        return 0;
+    }
+    if ((size_t)st.st_size < sizeof(SnapHeader) ||
+        (data = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+        fprintf(stderr, "%s is not a snapshot\n", path);
+        close(fd);
+        return 0;
+    }
+    close(fd);
+    header = (const SnapHeader*)data;
+    if (memcmp(header->magic, "MCSNAP01", 8) != 0 || header->nsym < 0 || header->nsym > TBLSIZE ||
+        (uint64_t)st.st_size != sizeof(SnapHeader) + header->nsym * sizeof(SnapSymbol) + header->codeLen) {
+        fprintf(stderr, "%s is not a snapshot\n", path);
+        munmap(data, st.st_size);
+        return 0;
+    }
+    if (memcmp(header->stamp, buildStamp(), sizeof(header->stamp)) != 0 || header->options != optionsKey()) {
+        fprintf(stderr, "%s was saved by another build or with other options\n", path);
+        munmap(data, st.st_size);
+        return 0;
+    }
+    sym = (const SnapSymbol*)(data + sizeof(SnapHeader));
+    for (int i = 0; i < header->nsym; i++) {
+        memcpy(table[i].name, sym[i].name, MAXLEN);
+        table[i].name[MAXLEN - 1] = '\0';
+        table[i].val = sym[i].val;
+        table[i].known = sym[i].known;
+        table[i].reg = -1;
+    }
+    sbcount = header->nsym;
+    // through emit, so a snapshot saved on top of this one holds it too
+    code = (const char*)(sym + header->nsym);
+    for (uint64_t off = 0, n; off < header->codeLen; off += n) {
+        n = header->codeLen - off < (1u << 30) ? header->codeLen - off : (1u << 30);
+        emit("%.*s", (int)n, code + off);
+    }
+    munmap(data, st.st_size);
+    return 1;
+}
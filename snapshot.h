@@ -0,0 +1,19 @@
+#ifndef __SNAPSHOT__
+#define __SNAPSHOT__
+
+// Set with -fsnapshot-save=FILE: at the end of the program the state the
+// compiled statements left is saved to FILE before the end code is printed
+extern const char *snapshotSave;
+
+// Collect the code printed from here on, so the snapshot can hold it
+extern void openSnapshotSave(const char *path);
+
+// Write the symbol table, its facts and the code printed so far to the
+// snapshot file, then print the code. Called by endProgram
+extern void saveSnapshot(void);
+
+// Start from a snapshot saved with the same build and options: restore
+// the symbol table and print the saved code. Return 0 on error
+extern int loadSnapshot(const char *path);
+
+#endif // __SNAPSHOT__
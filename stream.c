@@ -0,0 +1,298 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stream.h"
+#include "codeGen.h"
+#include "trace.h"
+#include "memstat.h"
+
+int optStream = 0;
+
+// What the parser knows about a subexpression; the nodes evaluateTree
+// would visit are emitted as soon as they are recognized
+typedef struct {
+    int reg;            // register of the value, -1 for a variable not loaded yet
+    size_t pre;         // offset of its prefix form
+    int hasVar;         // names a variable
+    int val;            // value if it names no variable, for the DIVZERO check
+    char name[MAXLEN];  // the variable while reg is -1
+} Value;
+
+// The prefix line is printed before the code, so both are kept until
+// the end of the statement
+static OutBuf prefix = { NULL, 0, 0 };
+static OutBuf code = { NULL, 0, 0 };
+// An undefined variable was read or the registers ran out: evaluateTree
+// would stop there, so no more code is kept, but the rest of the
+// statement is still parsed for syntax errors
+static int failed = 0;
+static int runout = 0;
+
+static void streamAssign(Value *v);
+
+// A new register, or a stand-in once the registers of the target are all
+// in use, which fails the statement there
+static int newRegister(void) {
+    if (!registersFull()) return allocateRegister();
+    if (!failed) runout = 1;
+    failed = 1;
+    return targetRegs;
+}
+
+// Append a lexeme and a blank to the prefix line
+static void prefixWord(const char *lexe) {
+    size_t n = strlen(lexe);
+
+    if (prefix.len + n + 2 > prefix.cap) {
+        prefix.data = (char*)memRealloc(MEM_CODE, prefix.data, prefix.cap, (prefix.len + n + 2) * 2);
+        prefix.cap = (prefix.len + n + 2) * 2;
+    }
+    memcpy(prefix.data + prefix.len, lexe, n);
+    prefix.data[prefix.len + n] = ' ';
+    prefix.len += n + 1;
+}
+
+// Put the lexeme of an operator in front of the prefix form of its left operand
+static void insertPrefix(size_t at, const char *lexe) {
+    size_t n = strlen(lexe) + 1;
+
+    prefixWord(lexe);
+    memmove(prefix.data + at + n, prefix.data + at, prefix.len - n - at);
+    memcpy(prefix.data + at, lexe, n - 1);
+    prefix.data[at + n - 1] = ' ';
+}
+
+// Load a variable read as a value, now that it is known not to be assigned
+static void materialize(Value *v) {
+    int varidx;
+
+    if (v->reg != -1) return;
+    varidx = getvariable(v->name);
+    if (varidx == -1) failed = 1;
+    v->reg = newRegister();
+    if (!failed) emitTo(&code, "%s r%d [%d]\n", backend->mnemonic[OP_MOV], v->reg, varAddress(varidx));
+}
+
+static void constant(Value *v, const char *lexe) {
+    v->pre = prefix.len;
+    prefixWord(lexe);
+    v->reg = newRegister();
+    v->hasVar = 0;
+    v->val = atoi(lexe);
+    if (!failed) emitTo(&code, "%s r%d %s\n", backend->mnemonic[OP_MOV], v->reg, lexe);
+}
+
+static void variable(Value *v, const char *lexe) {
+    v->pre = prefix.len;
+    prefixWord(lexe);
+    v->reg = -1;
+    v->hasVar = 1;
+    strcpy(v->name, lexe);
+}
+
+static const char *opcode(const char *lexe) {
+    switch (lexe[0]) {
+    case '+': return backend->mnemonic[OP_ADD];
+    case '-': return backend->mnemonic[OP_SUB];
+    case '*': return backend->mnemonic[OP_MUL];
+    case '/': return backend->mnemonic[OP_DIV];
+    case '|': return backend->mnemonic[OP_OR];
+    case '&': return backend->mnemonic[OP_AND];
+    default: return backend->mnemonic[OP_XOR];
+    }
+}
+
+// left op= right, both in registers, like evaluateTree
+static void combine(Value *left, const char *lexe, Value *right) {
+    unsigned l = (unsigned)left->val, r = (unsigned)right->val;
+
+    if (!failed) emitTo(&code, "%s r%d r%d\n", opcode(lexe), left->reg, right->reg);
+    freeRegister();
+    left->hasVar |= right->hasVar;
+    if (left->hasVar) return;
+    switch (lexe[0]) {
+    case '+': left->val = (int)(l + r); break;
+    case '-': left->val = (int)(l - r); break;
+    case '*': left->val = (int)(l * r); break;
+    case '/': left->val = right->val == -1 ? (int)(0 - l) : right->val ? left->val / right->val : 0; break;
+    case '|': left->val = (int)(l | r); break;
+    case '&': left->val = (int)(l & r); break;
+    default: left->val = (int)(l ^ r); break;
+    }
+}
+
+// factor := INT | ADDSUB INT | ID | ADDSUB ID | ID ASSIGN expr |
+//           LPAREN expr RPAREN | ADDSUB LPAREN expr RPAREN
+static void streamFactor(Value *v) {
+    Value right;
+    char lexe[MAXLEN];
+    size_t at;
+
+    if (match(INT)) {
+        constant(v, getLexeme());
+        advance();
+    } else if (match(ID)) {
+        variable(v, getLexeme());
+        advance();
+    } else if (match(ADDSUB)) {
+        strcpy(lexe, getLexeme());
+        at = prefix.len;
+        prefixWord(lexe);
+        constant(v, "0");
+        advance();
+        if (match(INT)) {
+            constant(&right, getLexeme());
+            advance();
+        } else if (match(ID)) {
+            variable(&right, getLexeme());
+            advance();
+        } else if (match(LPAREN)) {
+            advance();
+            streamAssign(&right);
+            if (match(RPAREN))
+                advance();
+            else
+                error(MISPAREN);
+        } else {
+            error(NOTNUMID);
+        }
+        materialize(&right);
+        combine(v, lexe, &right);
+        v->pre = at;
+    } else if (match(LPAREN)) {
+        advance();
+        streamAssign(v);
+        if (match(RPAREN))
+            advance();
+        else
+            error(MISPAREN);
+    } else {
+        error(NOTNUMID);
+    }
+}
+
+static void streamUnary(Value *v) {
+    Value var;
+    char lexe[MAXLEN];
+    int varidx;
+
+    if (!match(UNARY)) {
+        streamFactor(v);
+        return;
+    }
+    strcpy(lexe, getLexeme());
+    v->pre = prefix.len;
+    prefixWord(lexe);
+    advance();
+    if (!match(ID)) error(NOTNUMID);
+    variable(&var, getLexeme());
+    advance();
+    prefixWord("1");
+
+    varidx = getvariable(var.name);
+    if (varidx == -1) failed = 1;
+    v->reg = newRegister();
+    v->hasVar = 1;
+    if (failed) return;
+    emitTo(&code, "%s r%d 1\n", backend->mnemonic[OP_MOV], v->reg);
+    var.reg = newRegister();
+    if (failed) return;
+    emitTo(&code, "%s r%d [%d]\n", backend->mnemonic[OP_MOV], var.reg, varAddress(varidx));
+    emitTo(&code, "%s r%d r%d\n", opcode(lexe), var.reg, v->reg);
+    emitTo(&code, "%s [%d] r%d\n", backend->mnemonic[OP_MOV], varAddress(varidx), var.reg);
+    emitTo(&code, "%s r%d r%d\n", backend->mnemonic[OP_MOV], v->reg, var.reg);
+    freeRegister();
+}
+
+// Left-associative operators of one precedence level
+static void binary(Value *left, TokenSet op, void (*operand)(Value *v)) {
+    Value right;
+    char lexe[MAXLEN];
+
+    operand(left);
+    while (match(op)) {
+        strcpy(lexe, getLexeme());
+        materialize(left);
+        insertPrefix(left->pre, lexe);
+        advance();
+        operand(&right);
+        // the check term_tail does with evalValue
+        if (op == MULDIV && !right.hasVar && right.val == 0)
+            error(DIVZERO);
+        materialize(&right);
+        combine(left, lexe, &right);
+    }
+}
+
+static void streamTerm(Value *v) { binary(v, MULDIV, streamUnary); }
+static void streamExpr(Value *v) { binary(v, ADDSUB, streamTerm); }
+static void streamAnd(Value *v) { binary(v, AND, streamExpr); }
+static void streamXor(Value *v) { binary(v, XOR, streamAnd); }
+static void streamOr(Value *v) { binary(v, OR, streamXor); }
+
+static void streamAssign(Value *v) {
+    Value right;
+    char lexe[MAXLEN];
+    int varidx;
+
+    streamOr(v);
+    if (v->reg != -1 || !(match(ASSIGN) || match(ADDSUB_ASSIGN))) return;
+    strcpy(lexe, getLexeme());
+    insertPrefix(v->pre, lexe);
+    varidx = getvariable(v->name);
+    if (match(ASSIGN)) {
+        if (varidx == -1) varidx = setvariable(v->name);
+        advance();
+        streamAssign(&right);
+        materialize(&right);
+        if (!failed) emitTo(&code, "%s [%d] r%d\n", backend->mnemonic[OP_MOV], varAddress(varidx), right.reg);
+    } else {
+        if (varidx == -1) failed = 1;
+        advance();
+        streamAssign(&right);
+        materialize(&right);
+        if (!failed) v->reg = newRegister();
+        if (!failed) {
+            emitTo(&code, "%s r%d [%d]\n", backend->mnemonic[OP_MOV], v->reg, varAddress(varidx));
+            emitTo(&code, "%s r%d r%d\n", opcode(lexe), v->reg, right.reg);
+            emitTo(&code, "%s [%d] r%d\n", backend->mnemonic[OP_MOV], varAddress(varidx), v->reg);
+            emitTo(&code, "%s r%d r%d\n", backend->mnemonic[OP_MOV], right.reg, v->reg);
+            freeRegister();
+        }
+    }
+    v->reg = right.reg;
+    v->hasVar = 1;
+}
+
+void streamStatement(void) {
+    static long long count = 0;
+    Value v;
+    long long start;
+    int line;
+
+    if (match(ENDFILE)) {
+        endProgram();
+        exit(0);
+    } else if (match(END)) {
+        advance();
+    } else {
+        start = traceClock();
+        line = codeLine = lexLine();
+        memPhase(MEMPHASE_PARSE);
+        resetRegister();
+        prefix.len = code.len = 0;
+        failed = runout = 0;
+        streamAssign(&v);
+        if (!match(END)) error(SYNTAXERR);
+        materialize(&v);
+        emit("%.*s\n", (int)prefix.len, prefix.data);
+        if (code.len > 0) emit("%.*s", (int)code.len, code.data);
+        if (runout) outOfRegisters();
+        if (failed) error(UNDEFVAR);
+        memEndStatement(line);
+        traceLex(start);
+        traceSpan("streamStatement", start, "n", ++count);
+        advance();
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef __STREAM__
+#define __STREAM__
+
+// Enabled with -fstream
+extern int optStream;
+
+// statement := ENDFILE | END | expr END, compiled while it is parsed
+// without building a tree. Prints the same prefix line and code as
+// statement when no optimization is enabled.
+extern void streamStatement(void);
+
+#endif // __STREAM__
@@ -0,0 +1,549 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "rules.h"
+#include "codeGen.h"
+#include "isel.h"
+#include "sim.h"
+
+// Superoptimizer for the right sides of short assignments
+// Usage: superopt [-o rules.db] [-n N] [-l N] [-s N] [-c latency.cfg] [-fisel] [file]
+// Counts the shapes (see exprShape) of the assignments of a program and
+// searches the N most frequent ones not in the database yet for the
+// cheapest instruction sequence computing the same value. A sequence that
+// passes the tests and beats the code of the compiler goes into the
+// database, which the compiler reads with -frules.
+// -o FILE   rule database to extend, default rules.db
+// -n N      shapes to search, default 20
+// -l N      longest sequence to try, default 5
+// -s N      states a search may keep, default 1000000
+// -c FILE   latency table for the cost, in the format of sim -c
+// -fisel    search and compare against the forms of -fisel
+
+#define TESTS 8         // inputs every state is evaluated on
+#define MAXCONST 4      // immediates a sequence may use
+#define MAXGOALS 64     // sequences reaching the value verified per shape
+
+// Machine state after a sequence, on every test input
+typedef struct {
+    int32_t reg[RULEREGS][TESTS];
+    uint8_t defined;    // registers written
+    uint8_t faulted;    // tests that divided by zero
+    uint8_t len;
+    int parent;         // state before the last instruction, -1 at the start
+    Instr ins;          // the last instruction
+} State;
+
+typedef struct {
+    char shape[MAXSHAPE];
+    char *line;         // an assignment of this shape
+    int count;
+} Shape;
+
+static SimConfig cost;
+static int maxStates = 1000000, maxLen = 5;
+
+static State *states;
+static uint64_t *seen;          // fingerprints of the states, 0 if empty
+static size_t seenMask;
+
+// Inputs of the variables and the value and faults of the compiler's code
+static int32_t input[TESTS][RULEVARS];
+static int32_t want[TESTS];
+static uint8_t wantFault;
+
+static int nvar, nconst;
+static int32_t consts[MAXCONST];
+
+static uint64_t rng = 0x2545f4914f6cdd1dull;
+
+static uint32_t random32(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (uint32_t)(rng >> 16);
+}
+
+// Mostly small values, where the identities of the operators differ
+static int32_t randomValue(void) {
+    switch (random32() % 4) {
+    case 0: return (int32_t)(random32() % 17) - 8;
+    case 1: return (int32_t)(random32() % 2001) - 1000;
+    default: return (int32_t)random32();
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: superopt [-o rules.db] [-n N] [-l N] [-s N] [-c latency.cfg] [-fisel] [file]\n");
+    exit(2);
+}
+
+// Run code on a machine with the variables at [4*i]; return 0 on a fault
+static int run(const Instr *code, int n, const int32_t *vars, int dst, int32_t *result) {
+    static Machine m;
+
+    resetMachine(&m, &cost);
+    for (int i = 0; i < nvar; i++)
+        m.mem[i] = vars[i];
+    for (int i = 0; i < n && step(&m, &code[i]); i++);
+    *result = m.mem[dst];
+    return m.fault == NULL;
+}
+
+// ALU semantics of step, on one test
+static int32_t apply(Opcode op, int32_t a, int32_t b, int *fault) {
+    uint32_t x = (uint32_t)a, y = (uint32_t)b;
+
+    switch (op) {
+    case OP_MOV: return b;
+    case OP_ADD: return (int32_t)(x + y);
+    case OP_SUB: return (int32_t)(x - y);
+    case OP_MUL: return (int32_t)(x * y);
+    case OP_AND: return a & b;
+    case OP_OR:  return a | b;
+    case OP_XOR: return a ^ b;
+    case OP_INC: return (int32_t)(x + 1);
+    case OP_DEC: return (int32_t)(x - 1);
+    case OP_DIV:
+        if (b == 0) {
+            *fault = 1;
+            return 0;
+        }
+        if (a == INT32_MIN && b == -1) return a;
+        return a / b;
+    default:
+        return 0;
+    }
+}
+
+static uint64_t fingerprint(const State *s) {
+    uint64_t h = 14695981039346656037ull ^ ((uint64_t)s->defined << 8 | s->faulted);
+
+    for (int r = 0; r < RULEREGS; r++) {
+        if (!(s->defined >> r & 1)) continue;
+        for (int t = 0; t < TESTS; t++)
+            if (!(s->faulted >> t & 1)) h = (h ^ (uint32_t)s->reg[r][t] ^ (uint64_t)r << 32) * 1099511628211ull;
+    }
+    return h ? h : 1;
+}
+
+// Add a state unless an equal one was reached with fewer instructions
+static int remember(const State *s, int *nstates) {
+    uint64_t h = fingerprint(s);
+    size_t i;
+
+    for (i = h & seenMask; seen[i] != 0; i = (i + 1) & seenMask)
+        if (seen[i] == h) return -1;
+    if (*nstates == maxStates) return -1;
+    seen[i] = h;
+    states[*nstates] = *s;
+    return (*nstates)++;
+}
+
+// Register holding the value of the expression on every test, or -1
+static int goalRegister(const State *s) {
+    int r, t;
+
+    if (s->faulted != wantFault) return -1;
+    for (r = 0; r < RULEREGS; r++) {
+        if (!(s->defined >> r & 1)) continue;
+        for (t = 0; t < TESTS && ((wantFault >> t & 1) || s->reg[r][t] == want[t]); t++);
+        if (t == TESTS) return r;
+    }
+    return -1;
+}
+
+// Execute ins on every test of from
+static void extend(const State *from, const Instr *ins, State *to) {
+    int r = ins->dst.val, fault, t;
+    int32_t b = 0;
+
+    *to = *from;
+    to->ins = *ins;
+    to->len = from->len + 1;
+    to->defined |= (uint8_t)(1 << r);
+    for (t = 0; t < TESTS; t++) {
+        if (to->faulted >> t & 1) continue;
+        if (ins->src.kind == OPND_REG) b = from->reg[ins->src.val][t];
+        else if (ins->src.kind == OPND_MEM) b = input[t][ins->src.val / 4];
+        else if (ins->src.kind == OPND_IMM) b = ins->src.val;
+        fault = 0;
+        to->reg[r][t] = apply(ins->op, from->reg[r][t], b, &fault);
+        if (fault) to->faulted |= (uint8_t)(1 << t);
+    }
+}
+
+// The instructions worth trying after s: a register is written for the
+// first time only if it is the lowest one not written yet
+static int moves(const State *s, Instr *out) {
+    static const Opcode alu[] = { OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_AND, OP_OR, OP_XOR };
+    int n = 0, r, q, i, k, fresh = 0;
+    Instr in;
+
+    while (s->defined >> fresh & 1) fresh++;
+    for (r = 0; r < RULEREGS; r++) {
+        in.dst.kind = OPND_REG;
+        in.dst.val = r;
+        if (!(s->defined >> r & 1) && r != fresh) continue;
+        in.op = OP_MOV;
+        for (i = 0; i < nvar; i++) {
+            in.src.kind = OPND_MEM;
+            in.src.val = 4 * i;
+            out[n++] = in;
+        }
+        for (i = 0; i < nconst; i++) {
+            in.src.kind = OPND_IMM;
+            in.src.val = consts[i];
+            out[n++] = in;
+        }
+        for (q = 0; q < RULEREGS; q++) {
+            if (q == r || !(s->defined >> q & 1)) continue;
+            in.src.kind = OPND_REG;
+            in.src.val = q;
+            out[n++] = in;
+        }
+        if (!(s->defined >> r & 1)) continue;
+        for (k = 0; k < (int)(sizeof(alu) / sizeof(alu[0])); k++) {
+            in.op = alu[k];
+            for (q = 0; q < RULEREGS; q++) {
+                if (!(s->defined >> q & 1)) continue;
+                in.src.kind = OPND_REG;
+                in.src.val = q;
+                out[n++] = in;
+            }
+            for (i = 0; optIsel && i < nvar; i++) {
+                in.src.kind = OPND_MEM;
+                in.src.val = 4 * i;
+                out[n++] = in;
+            }
+            for (i = 0; optIsel && i < nconst; i++) {
+                in.src.kind = OPND_IMM;
+                in.src.val = consts[i];
+                out[n++] = in;
+            }
+        }
+        if (optIsel) {
+            in.src.kind = OPND_NONE;
+            in.op = OP_INC;
+            out[n++] = in;
+            in.op = OP_DEC;
+            out[n++] = in;
+        }
+    }
+    return n;
+}
+
+// The instructions of state s, the register holding the result renamed
+// r0, then the store to dst
+static int sequence(int s, int result, int dst, Instr *code) {
+    int n = states[s].len, i, r;
+
+    for (i = n - 1; i >= 0; i--, s = states[s].parent) {
+        code[i] = states[s].ins;
+        for (r = 0; r < 2; r++) {
+            Operand *o = r ? &code[i].src : &code[i].dst;
+            if (o->kind != OPND_REG) continue;
+            if (o->val == result) o->val = 0;
+            else if (o->val == 0) o->val = result;
+        }
+    }
+    code[n].op = OP_MOV;
+    code[n].dst.kind = OPND_MEM;
+    code[n].dst.val = 4 * dst;
+    code[n].src.kind = OPND_REG;
+    code[n].src.val = 0;
+    return n + 1;
+}
+
+// Compare code with the compiler's on random inputs and on every
+// combination of boundary values, and on a range around zero
+static int verify(const Instr *code, int n, const Instr *base, int nbase) {
+    static const int32_t edge[] = {
+        0, 1, -1, 2, -2, 3, 7, -8, 255, 256, 65535, 65536, -65536,
+        INT32_MAX, INT32_MIN, INT32_MAX - 1, INT32_MIN + 1, 0x55555555
+    };
+    int nedge = sizeof(edge) / sizeof(edge[0]), span = nvar == 1 ? 65536 : nvar == 2 ? 64 : 8;
+    int32_t vars[RULEVARS] = { 0 }, a, b;
+    long long i, total;
+    int k, fa, fb;
+
+    for (i = 0; i < 20000; i++) {
+        for (k = 0; k < nvar; k++) vars[k] = randomValue();
+        fa = run(code, n, vars, nvar, &a);
+        fb = run(base, nbase, vars, nvar, &b);
+        if (fa != fb || (fa && a != b)) return 0;
+    }
+    // every combination of the boundary values, then of -span .. span
+    for (total = 1, k = 0; k < nvar; k++) total *= nedge;
+    for (i = 0; i < total; i++) {
+        long long c = i;
+        for (k = 0; k < nvar; k++, c /= nedge) vars[k] = edge[c % nedge];
+        fa = run(code, n, vars, nvar, &a);
+        fb = run(base, nbase, vars, nvar, &b);
+        if (fa != fb || (fa && a != b)) return 0;
+    }
+    for (total = 1, k = 0; k < nvar; k++) total *= 2 * span + 1;
+    for (i = 0; i < total; i++) {
+        long long c = i;
+        for (k = 0; k < nvar; k++, c /= 2 * span + 1) vars[k] = (int32_t)(c % (2 * span + 1)) - span;
+        fa = run(code, n, vars, nvar, &a);
+        fb = run(base, nbase, vars, nvar, &b);
+        if (fa != fb || (fa && a != b)) return 0;
+    }
+    return 1;
+}
+
+// Parse one assignment into a tree, NULL if the line is not one
+static Tree *parseLine(const char *line) {
+    OutBuf scratch = { NULL, 0, 0 };
+    Tree *t = newTree();
+    jmp_buf jb;
+    int ok = 0;
+
+    setOutput(&scratch);
+    errorJump = &jb;
+    if (setjmp(jb) == 0) {
+        setLexBuffer(line, strlen(line));
+        if (!match(END) && !match(ENDFILE)) {
+            assign_expr(t);
+            ok = match(END) || match(ENDFILE);
+        }
+    }
+    errorJump = NULL;
+    setOutput(NULL);
+    freeOutput(&scratch);
+    if (!ok) {
+        freeTree(t);
+        return NULL;
+    }
+    return t;
+}
+
+// Index of the root if it is an assignment, -1 otherwise
+static int assignment(Tree *t) {
+    return t->node[t->n - 1].data == ASSIGN ? t->n - 1 : -1;
+}
+
+static void collectConsts(Tree *t) {
+    int i, k;
+    int32_t v;
+
+    for (k = 0; k < t->n; k++) {
+        if (t->node[k].data != INT) continue;
+        v = (int32_t)strtol(nodeLexeme(t, k), NULL, 10);
+        for (i = 0; i < nconst && consts[i] != v; i++);
+        if (i == nconst && nconst < MAXCONST) consts[nconst++] = v;
+    }
+}
+
+// Rename the variables the right side reads vi and the target d
+static void renameVars(Tree *t, const char names[RULEVARS][MAXLEN]) {
+    char name[16];
+
+    for (int k = 0; k < t->n; k++) {
+        if (t->node[k].data != ID) continue;
+        if (t->node[k].flags & NODE_ASSIGNED) {
+            t->node[k].lexeme = addText(t, "d");
+            continue;
+        }
+        for (int i = 0; i < nvar; i++)
+            if (strcmp(nodeLexeme(t, k), names[i]) == 0) {
+                sprintf(name, "v%d", i);
+                t->node[k].lexeme = addText(t, name);
+                break;
+            }
+    }
+}
+
+// The code the compiler prints for the tree, with vi at [4*i] and the
+// target after them
+static int compilerCode(Tree *t, Instr *code) {
+    OutBuf out = { NULL, 0, 0 };
+    char name[16], *line, *end;
+    int n = 0;
+
+    sbcount = 0;
+    for (int i = 0; i < nvar; i++) {
+        sprintf(name, "v%d", i);
+        setvariable(name);
+    }
+    setvariable("d");
+    setOutput(&out);
+    resetRegister();
+    if (optIsel) selectTree(t);
+    else evaluateTree(t);
+    setOutput(NULL);
+    for (line = out.data; line != NULL && line < out.data + out.len && n < 64; line = end + 1) {
+        end = strchr(line, '\n');
+        *end = '\0';
+        if (parseInstr(line, &code[n])) n++;
+    }
+    freeOutput(&out);
+    return n;
+}
+
+// Search the shape of line; print its rule to db if one beats the compiler
+static int superoptimize(const Shape *sh, FILE *db) {
+    static Instr next[1024];
+    Instr base[64], code[RULELEN + 1], best[RULELEN + 1];
+    const char *names[RULEVARS];
+    char lexemes[RULEVARS][MAXLEN], shape[MAXSHAPE], text[64];
+    Tree *tree = parseLine(sh->line);
+    long long baseCost, bestCost = -1, c;
+    int nbase, nstates = 1, lo = 0, hi = 1, len, s, i, k, m, t, r, ngoals = 0, bestLen = 0, goals[MAXGOALS];
+    State st;
+
+    nvar = exprShape(tree, tree->node[assignment(tree)].right, shape, names);
+    for (i = 0; i < nvar; i++)
+        strcpy(lexemes[i], names[i]);
+    renameVars(tree, lexemes);
+    nconst = 0;
+    collectConsts(tree);
+    nbase = compilerCode(tree, base);
+    freeTree(tree);
+    baseCost = blockCycles(&cost, base, nbase);
+
+    for (t = 0; t < TESTS; t++) {
+        for (i = 0; i < nvar; i++) input[t][i] = randomValue();
+        if (!run(base, nbase, input[t], nvar, &want[t])) wantFault |= (uint8_t)(1 << t);
+        else wantFault &= (uint8_t)~(1 << t);
+    }
+
+    memset(seen, 0, sizeof(uint64_t) * (seenMask + 1));
+    memset(&st, 0, sizeof(st));
+    st.parent = -1;
+    remember(&st, &nstates);
+    nstates = 1;
+    // breadth first, so every state is first reached by a shortest sequence
+    for (len = 1; len <= maxLen && len < nbase && ngoals < MAXGOALS; len++) {
+        for (s = lo; s < hi && ngoals < MAXGOALS; s++) {
+            m = moves(&states[s], next);
+            for (k = 0; k < m; k++) {
+                extend(&states[s], &next[k], &st);
+                st.parent = s;
+                if ((i = remember(&st, &nstates)) < 0) continue;
+                if (goalRegister(&states[i]) >= 0 && ngoals < MAXGOALS) goals[ngoals++] = i;
+            }
+        }
+        lo = hi;
+        hi = nstates;
+    }
+
+    for (i = 0; i < ngoals; i++) {
+        r = goalRegister(&states[goals[i]]);
+        k = sequence(goals[i], r, nvar, code);
+        c = blockCycles(&cost, code, k);
+        if (bestCost >= 0 && (c > bestCost || (c == bestCost && k >= bestLen))) continue;
+        if (c > baseCost || (c == baseCost && k >= nbase)) continue;
+        if (!verify(code, k, base, nbase)) continue;
+        bestCost = c;
+        bestLen = k;
+        memcpy(best, code, sizeof(Instr) * k);
+    }
+    fprintf(stderr, "%-32s %6d uses %8d states %4d found  %3lld -> ", sh->shape, sh->count, nstates, ngoals, baseCost);
+    if (bestCost < 0) {
+        fprintf(stderr, "no better code\n");
+        return 0;
+    }
+    fprintf(stderr, "%lld cycles\n", bestCost);
+    fprintf(db, "%d\t%s\t%lld\t", optIsel, sh->shape, bestCost);
+    for (i = 0; i < bestLen - 1; i++) {
+        formatInstr(&best[i], text);
+        fprintf(db, "%s%s", i ? "; " : "", text);
+    }
+    fprintf(db, "\n");
+    return 1;
+}
+
+static int compareCounts(const void *a, const void *b) {
+    return ((const Shape*)b)->count - ((const Shape*)a)->count;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL, *dbPath = "rules.db", *names[RULEVARS];
+    char *line = NULL, shape[MAXSHAPE], known[1024], *tab;
+    size_t cap = 0;
+    Shape *shapes = NULL;
+    int nshapes = 0, shapeCap = 0, nsearch = 20, i, j, added = 0;
+    FILE *fp = stdin, *db;
+    Tree *t;
+    size_t seenSize;
+
+    initSimConfig(&cost);
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) dbPath = argv[++i];
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) nsearch = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) maxLen = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) maxStates = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            if (!loadSimConfig(&cost, argv[++i])) return 2;
+        }
+        else if (strcmp(argv[i], "-fisel") == 0) optIsel = 1;
+        else if (argv[i][0] == '-' || path != NULL) usage();
+        else path = argv[i];
+    }
+    if (maxLen < 1 || maxLen > RULELEN || maxStates < 1) usage();
+    if (path != NULL && (fp = fopen(path, "r")) == NULL) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return 2;
+    }
+
+    initTable();
+    while (getline(&line, &cap, fp) > 0) {
+        if ((t = parseLine(line)) == NULL) continue;
+        if (assignment(t) >= 0 && exprShape(t, t->node[assignment(t)].right, shape, names) >= 0) {
+            for (i = 0; i < nshapes && strcmp(shapes[i].shape, shape) != 0; i++);
+            if (i == nshapes) {
+                if (nshapes == shapeCap) {
+                    shapeCap = shapeCap ? shapeCap * 2 : 64;
+                    shapes = (Shape*)realloc(shapes, sizeof(Shape) * shapeCap);
+                }
+                strcpy(shapes[i].shape, shape);
+                shapes[i].line = strdup(line);
+                shapes[i].count = 0;
+                nshapes++;
+            }
+            shapes[i].count++;
+        }
+        freeTree(t);
+    }
+    if (fp != stdin) fclose(fp);
+    qsort(shapes, nshapes, sizeof(Shape), compareCounts);
+
+    // shapes already in the database for these forms are not searched again
+    if ((db = fopen(dbPath, "r")) != NULL) {
+        while (fgets(known, sizeof(known), db) != NULL) {
+            if (known[0] == '#' || atoi(known) != optIsel || (tab = strchr(known, '\t')) == NULL) continue;
+            for (j = 0; j < nshapes; j++)
+                if (strncmp(tab + 1, shapes[j].shape, strlen(shapes[j].shape)) == 0 &&
+                    tab[1 + strlen(shapes[j].shape)] == '\t') {
+                    shapes[j].count = -1;
+                }
+        }
+        fclose(db);
+    }
+    if ((db = fopen(dbPath, "a")) == NULL) {
+        perror(dbPath);
+        return 2;
+    }
+    if (ftell(db) == 0) {
+        fprintf(db, "# superopt rules: isel, shape, cycles, code\n");
+        fprintf(db, "# vi is read at [4*i]; the code leaves the value in r0\n");
+    }
+
+    states = (State*)malloc(sizeof(State) * maxStates);
+    for (seenSize = 1; seenSize < 2 * (size_t)maxStates; seenSize *= 2);
+    seen = (uint64_t*)malloc(sizeof(uint64_t) * seenSize);
+    seenMask = seenSize - 1;
+    for (i = 0; i < nshapes && nsearch > 0; i++) {
+        if (shapes[i].count < 0) continue;
+        added += superoptimize(&shapes[i], db);
+        nsearch--;
+        fflush(db);
+    }
+    fclose(db);
+    fprintf(stderr, "%d rules added to %s\n", added, dbPath);
+    return 0;
+}
@@ -0,0 +1,91 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "trace.h"
+#include "lex.h"
+
+int tracing = 0;
+
+static FILE *traceFile = NULL;
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+static long long traceStart = 0;
+static int events = 0;
+
+// Thread id in the timeline, the main thread is 1
+static _Thread_local int tid = 1;
+// Token reading time already reported by traceLex
+static _Thread_local long long lexReported = 0, tokensReported = 0;
+
+static long long now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void closeTrace(void) {
+    pthread_mutex_lock(&traceLock);
+    fprintf(traceFile, "\n]\n");
+    fclose(traceFile);
+    traceFile = NULL;
+    tracing = 0;
+    pthread_mutex_unlock(&traceLock);
+}
+
+void openTrace(const char *path) {
+    if ((traceFile = fopen(path, "w")) == NULL) {
+        perror(path);
+        exit(2);
+    }
+    fprintf(traceFile, "[\n");
+    traceStart = now();
+    tracing = 1;
+    traceThreadName(1, "main");
+    atexit(closeTrace);
+}
+
+long long traceClock(void) {
+    return tracing ? now() : 0;
+}
+
+// Times are in microseconds from the start of the trace
+static void writeSpan(const char *name, long long start, long long dur, const char *argName, long long arg) {
+    pthread_mutex_lock(&traceLock);
+    if (traceFile != NULL) {
+        fprintf(traceFile, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+            events++ ? ",\n" : "", name, (int)getpid(), tid, (start - traceStart) / 1000.0, dur / 1000.0);
+        if (argName != NULL) fprintf(traceFile, ",\"args\":{\"%s\":%lld}", argName, arg);
+        fprintf(traceFile, "}");
+    }
+    pthread_mutex_unlock(&traceLock);
+}
+
+void traceSpan(const char *name, long long start, const char *argName, long long arg) {
+    if (!tracing) return;
+    writeSpan(name, start, now() - start, argName, arg);
+}
+
+void traceLex(long long start) {
+    long long nanos, tokens;
+
+    if (!tracing) return;
+    lexStats(&nanos, &tokens);
+    writeSpan("lex", start, nanos - lexReported, "tokens", tokens - tokensReported);
+    lexReported = nanos;
+    tokensReported = tokens;
+}
+
+void traceSetThread(int id) {
+    tid = id;
+}
+
+void traceThreadName(int id, const char *name) {
+    if (!tracing) return;
+    pthread_mutex_lock(&traceLock);
+    if (traceFile != NULL)
+        fprintf(traceFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            events++ ? ",\n" : "", (int)getpid(), id, name);
+    pthread_mutex_unlock(&traceLock);
+}
@@ -0,0 +1,28 @@
+#ifndef __TRACE__
+#define __TRACE__
+
+// Set by openTrace
+extern int tracing;
+
+// Write a Chrome trace-event / Perfetto JSON timeline to path
+extern void openTrace(const char *path);
+
+// Current time in ns, 0 when not tracing
+extern long long traceClock(void);
+
+// Record a span from start to now on this thread, with an optional
+// integer argument (argName NULL for none)
+extern void traceSpan(const char *name, long long start, const char *argName, long long arg);
+
+// Record the time spent reading tokens since the last call as a "lex"
+// span starting at start; lexing is interleaved with parsing, so this
+// is the sum of the token reads
+extern void traceLex(long long start);
+
+// Record the spans of this thread under id, the main thread is 1
+extern void traceSetThread(int id);
+
+// Name thread id in the timeline
+extern void traceThreadName(int id, const char *name);
+
+#endif // __TRACE__